@@ -0,0 +1,8 @@
+-- Fill a schema with 10000 tables and drop it with DROP SCHEMA ... CASCADE,
+-- as a pgbench script:  10000 relation_create events from the statements run
+-- by the DO block, then 10000 relation_drop events from a single statement.
+-- Each transaction holds a lock on every table, so max_locks_per_transaction
+-- must be raised (run_bench.sh does so).
+CREATE SCHEMA bench_drop;
+DO $$ BEGIN FOR i IN 1..10000 LOOP EXECUTE format('CREATE TABLE bench_drop.t%s (a INTEGER)', i); END LOOP; END; $$;
+DROP SCHEMA bench_drop CASCADE;
@@ -0,0 +1,43 @@
+# A temporary instance for the scripts in this directory, which source this
+# file after setting PG_BINDIR and BENCH_PORT.  The instance is removed when
+# the script exits;  its log is $LOGFILE.
+#
+# pg_schema_triggers/bench/instance.sh
+
+DATADIR=$(mktemp -d "${TMPDIR:-/tmp}/schema_triggers_bench.XXXXXX")
+LOGFILE=$DATADIR/server.log
+PGOPTS="-h $DATADIR -p $BENCH_PORT"
+
+cleanup()
+{
+	"$PG_BINDIR/pg_ctl" -D "$DATADIR/data" -m immediate stop >/dev/null 2>&1 || true
+	rm -rf "$DATADIR"
+}
+trap cleanup EXIT INT TERM
+
+# Create the instance, with settings suited to many DDL statements.
+init_instance()
+{
+	"$PG_BINDIR/initdb" -D "$DATADIR/data" -A trust >/dev/null
+	cat >>"$DATADIR/data/postgresql.conf" <<EOF
+fsync = off
+max_connections = 40
+max_locks_per_transaction = 4096
+client_min_messages = warning
+log_min_messages = warning
+EOF
+}
+
+# Start (or restart) the instance, with the given shared_preload_libraries.
+start_server()
+{
+	"$PG_BINDIR/pg_ctl" -D "$DATADIR/data" -m fast stop >/dev/null 2>&1 || true
+	"$PG_BINDIR/pg_ctl" -D "$DATADIR/data" -l "$LOGFILE" -w \
+		-o "-p $BENCH_PORT -k $DATADIR -c listen_addresses='' -c shared_preload_libraries='$1'" \
+		start >/dev/null
+}
+
+psql_cmd()
+{
+	"$PG_BINDIR/psql" $PGOPTS -X -q -v ON_ERROR_STOP=1 -d postgres "$@"
+}
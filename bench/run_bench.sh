@@ -0,0 +1,101 @@
+#!/bin/sh
+#
+# Runs the pgbench workloads in this directory against a temporary instance,
+# first without the extension, then with it loaded and 0, 1, 10 and 100 event
+# triggers on each event the workloads raise.  Prints CSV to stdout and to
+# $BENCH_OUTPUT, one row per statement with its average latency plus one row
+# per run (with an empty statement) with the run's latency and throughput.
+#
+# The extension must already be installed (make install).  Settings, from
+# the environment:
+#
+#   PG_BINDIR         directory holding initdb, pg_ctl, psql and pgbench
+#                     (make bench passes pg_config --bindir)
+#   BENCH_DURATION    seconds to run each timed workload (default 10)
+#   BENCH_CLIENTS     pgbench clients for the utility and temp_table
+#                     workloads (default 1);  the others use fixed object
+#                     names, so always run with one
+#   BENCH_DROP_XACTS  transactions of the drop_schema workload (default 3)
+#   BENCH_TRIGGERS    trigger counts to run with the extension (default
+#                     "0 1 10 100")
+#   BENCH_PORT        port for the temporary instance (default 55432)
+#   BENCH_OUTPUT      CSV file to write (default bench/results.csv)
+#
+# pg_schema_triggers/bench/run_bench.sh
+
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+PG_BINDIR=${PG_BINDIR:-$(pg_config --bindir)}
+BENCH_DURATION=${BENCH_DURATION:-10}
+BENCH_CLIENTS=${BENCH_CLIENTS:-1}
+BENCH_DROP_XACTS=${BENCH_DROP_XACTS:-3}
+BENCH_TRIGGERS=${BENCH_TRIGGERS:-"0 1 10 100"}
+BENCH_PORT=${BENCH_PORT:-55432}
+BENCH_OUTPUT=${BENCH_OUTPUT:-$BENCH_DIR/results.csv}
+
+. "$BENCH_DIR/instance.sh"
+
+# Run one workload with pgbench -r, and turn its report into CSV rows.
+run_workload()
+{
+	config=$1
+	triggers=$2
+	workload=$3
+	clients=1
+	case $workload in
+		utility|temp_table) clients=$BENCH_CLIENTS ;;
+	esac
+	if [ "$workload" = drop_schema ]; then
+		limit="-t $BENCH_DROP_XACTS"
+	else
+		limit="-T $BENCH_DURATION"
+	fi
+
+	"$PG_BINDIR/pgbench" $PGOPTS -n -r -c "$clients" $limit \
+		-f "$BENCH_DIR/$workload.sql" postgres 2>/dev/null |
+	awk -v prefix="$SERVER_VERSION,$config,$triggers,$workload" -v clients="$clients" '
+		function csv(s) { gsub(/"/, "\"\"", s); return "\"" s "\"" }
+		/^tps = / { tps = $3 }
+		/^latency average = / { latency = $4 }
+		/^statement latencies/ { in_stmts = 1; failures = ($0 ~ /failures/); next }
+		in_stmts && NF >= 2 && $1 ~ /^[0-9.]+$/ {
+			stmt_latency = $1
+			$1 = ""
+			if (failures)
+				$2 = ""
+			sub(/^ +/, "")
+			print prefix "," csv($0) "," stmt_latency ","
+			next
+		}
+		in_stmts { in_stmts = 0 }
+		END {
+			if (latency == "" && tps > 0)
+				latency = 1000.0 * clients / tps
+			print prefix ",," latency "," tps
+		}' | tee -a "$BENCH_OUTPUT"
+}
+
+run_all_workloads()
+{
+	for workload in utility temp_table wide_table drop_schema; do
+		run_workload "$1" "$2" "$workload"
+	done
+}
+
+init_instance
+
+echo "server_version,config,triggers,workload,statement,latency_ms,tps" | tee "$BENCH_OUTPUT"
+
+# Without the extension.
+start_server ''
+SERVER_VERSION=$(psql_cmd -A -t -c "SHOW server_version_num")
+run_all_workloads none 0
+
+# With the extension loaded, and each number of triggers.
+start_server schema_triggers
+psql_cmd -f "$BENCH_DIR/setup.sql"
+for n in $BENCH_TRIGGERS; do
+	psql_cmd -c "SELECT bench_set_triggers($n)" >/dev/null
+	run_all_workloads loaded "$n"
+done
@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# Runs many sessions creating and dropping tenant tables at once, while
+# others create and drop event triggers, against a temporary instance with the
+# extension loaded.  Prints CSV to stdout and to $BENCH_OUTPUT, one row per
+# number of clients with the throughput, the number of clients which aborted
+# (because of an error, or because they leaked an event context), and the
+# number of leaked-context warnings in the server log.  Exits with status 1
+# if any client aborted or any context was leaked.
+#
+# The extension must already be installed (make install), into PostgreSQL 9.6
+# or later, for pgbench's client_id variable and script weights.  Settings,
+# from the environment:
+#
+#   PG_BINDIR         directory holding initdb, pg_ctl, psql and pgbench
+#                     (make stress passes pg_config --bindir)
+#   BENCH_DURATION    seconds to run each number of clients (default 10)
+#   STRESS_CLIENTS    numbers of clients to run (default "1 4 16")
+#   BENCH_PORT        port for the temporary instance (default 55432)
+#   BENCH_OUTPUT      CSV file to write (default bench/stress.csv)
+#
+# pg_schema_triggers/bench/run_stress.sh
+
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+PG_BINDIR=${PG_BINDIR:-$(pg_config --bindir)}
+BENCH_DURATION=${BENCH_DURATION:-10}
+STRESS_CLIENTS=${STRESS_CLIENTS:-"1 4 16"}
+BENCH_PORT=${BENCH_PORT:-55432}
+BENCH_OUTPUT=${BENCH_OUTPUT:-$BENCH_DIR/stress.csv}
+
+. "$BENCH_DIR/instance.sh"
+
+init_instance
+start_server schema_triggers
+psql_cmd -f "$BENCH_DIR/stress_setup.sql"
+SERVER_VERSION=$(psql_cmd -A -t -c "SHOW server_version_num")
+
+echo "server_version,clients,tps,aborted_clients,leaked_contexts" | tee "$BENCH_OUTPUT"
+
+status=0
+for clients in $STRESS_CLIENTS; do
+	: >"$DATADIR/pgbench.err"
+	tps=$("$PG_BINDIR/pgbench" $PGOPTS -n -c "$clients" -j "$clients" -T "$BENCH_DURATION" \
+			-f "$BENCH_DIR/stress_tenant.sql@9" -f "$BENCH_DIR/stress_triggers.sql@1" \
+			postgres 2>"$DATADIR/pgbench.err" |
+		awk '/^tps = / { tps = $3 } END { print tps }') || true
+	aborted=$(grep -c "aborted" "$DATADIR/pgbench.err" || true)
+	leaked=$(grep -c "leaked .* event trigger context" "$LOGFILE" || true)
+	echo "$SERVER_VERSION,$clients,$tps,$aborted,$leaked" | tee -a "$BENCH_OUTPUT"
+	if [ "$aborted" -ne 0 ] || [ "$leaked" -ne 0 ]; then
+		sed -e 's/^/pgbench: /' "$DATADIR/pgbench.err" >&2
+		status=1
+	fi
+done
+
+exit $status
@@ -0,0 +1,30 @@
+-- Setup for run_bench.sh:  bench_set_triggers(n) replaces the benchmark's
+-- event triggers with n no-op triggers on each event its workloads raise.
+CREATE EXTENSION IF NOT EXISTS schema_triggers;
+CREATE OR REPLACE FUNCTION bench_noop()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+	END;
+$$;
+CREATE OR REPLACE FUNCTION bench_set_triggers(n INTEGER)
+ RETURNS VOID
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		trigname NAME;
+		eventname TEXT;
+	BEGIN
+		FOR trigname IN SELECT evtname FROM pg_event_trigger WHERE evtname LIKE 'bench\_%' LOOP
+			EXECUTE format('DROP EVENT TRIGGER %I', trigname);
+		END LOOP;
+		FOREACH eventname IN ARRAY ARRAY['relation_create', 'relation_create_complete',
+				'relation_drop', 'column_add', 'column_alter'] LOOP
+			FOR i IN 1..n LOOP
+				EXECUTE format('CREATE EVENT TRIGGER %I ON %s EXECUTE PROCEDURE bench_noop()',
+							   format('bench_%s_%s', eventname, i), eventname);
+			END LOOP;
+		END LOOP;
+	END;
+$$;
@@ -0,0 +1,26 @@
+-- Setup for run_stress.sh:  event triggers on the events the stress
+-- workloads raise, one of which fails for tables named fail_*.
+CREATE EXTENSION IF NOT EXISTS schema_triggers;
+CREATE OR REPLACE FUNCTION stress_noop()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+	END;
+$$;
+CREATE OR REPLACE FUNCTION stress_relation_create()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		IF ((schema_triggers.get_relation_create_eventinfo()).new).relname LIKE 'fail\_%' THEN
+			RAISE EXCEPTION 'failing on purpose';
+		END IF;
+	END;
+$$;
+CREATE EVENT TRIGGER stress_relation_create ON relation_create
+	EXECUTE PROCEDURE stress_relation_create();
+CREATE EVENT TRIGGER stress_relation_drop ON relation_drop
+	EXECUTE PROCEDURE stress_noop();
+CREATE EVENT TRIGGER stress_column_add ON column_add
+	EXECUTE PROCEDURE stress_noop();
@@ -0,0 +1,14 @@
+-- Tenant tables created and dropped by many sessions at once, as a pgbench
+-- script (PostgreSQL 9.6 and up):  a column added in a subtransaction which is
+-- rolled back, and a table whose relation_create trigger fails, caught by the
+-- DO block.  The last statement fails, aborting the client, if the session
+-- has leaked an event context.
+BEGIN;
+CREATE TABLE tenant_:client_id (id INTEGER PRIMARY KEY, name TEXT);
+SAVEPOINT s;
+ALTER TABLE tenant_:client_id ADD COLUMN created TIMESTAMPTZ;
+ROLLBACK TO s;
+DO $$ BEGIN CREATE TABLE fail_tenant(); EXCEPTION WHEN raise_exception THEN NULL; END; $$;
+DROP TABLE tenant_:client_id;
+COMMIT;
+SELECT 1 / (schema_triggers.event_context_count() = 0)::INTEGER AS no_leaks;
@@ -0,0 +1,4 @@
+-- Event triggers created and dropped while other sessions run DDL, as a
+-- pgbench script (PostgreSQL 9.6 and up).
+CREATE EVENT TRIGGER stress_:client_id ON column_add EXECUTE PROCEDURE stress_noop();
+DROP EVENT TRIGGER stress_:client_id;
@@ -0,0 +1,4 @@
+-- Create and drop a temporary table, as a pgbench script:  one
+-- relation_create, relation_create_complete and relation_drop event each.
+CREATE TEMP TABLE bench_temp(a INTEGER, b TEXT);
+DROP TABLE bench_temp;
@@ -0,0 +1,9 @@
+-- Utility statements which raise no schema events, as a pgbench script, for
+-- measuring the overhead of the ProcessUtility hook alone.
+SET work_mem = '8MB';
+SHOW work_mem;
+RESET work_mem;
+BEGIN;
+SAVEPOINT bench;
+RELEASE SAVEPOINT bench;
+COMMIT;
@@ -0,0 +1,11 @@
+-- A wide-table migration, as a pgbench script:  add 200 columns to a table
+-- with one ALTER TABLE, then change the type of all of them with another.
+--
+--     psql -f bench/wide_table_setup.sql
+--     pgbench -n -f bench/wide_table.sql -t 100
+--
+-- (pgbench reads one command per line, hence the long lines.)
+DROP TABLE IF EXISTS bench_wide;
+CREATE TABLE bench_wide();
+DO $$ BEGIN EXECUTE 'ALTER TABLE bench_wide ' || (SELECT string_agg(format('ADD COLUMN c%s INTEGER', i), ', ') FROM generate_series(1, 200) i); END; $$;
+DO $$ BEGIN EXECUTE 'ALTER TABLE bench_wide ' || (SELECT string_agg(format('ALTER COLUMN c%s TYPE BIGINT', i), ', ') FROM generate_series(1, 200) i); END; $$;
@@ -0,0 +1,16 @@
+-- Setup for wide_table.sql:  event triggers on the column events, so that
+-- the pg_attribute rows of every added and altered column are captured.
+CREATE EXTENSION IF NOT EXISTS schema_triggers;
+CREATE OR REPLACE FUNCTION bench_noop()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+	END;
+$$;
+DROP EVENT TRIGGER IF EXISTS bench_column_add;
+DROP EVENT TRIGGER IF EXISTS bench_column_alter;
+CREATE EVENT TRIGGER bench_column_add ON column_add
+	EXECUTE PROCEDURE bench_noop();
+CREATE EVENT TRIGGER bench_column_alter ON column_alter
+	EXECUTE PROCEDURE bench_noop();
@@ -14,35 +14,78 @@
 #include "access/sysattr.h"
 #include "access/xact.h"
 #include "catalog/indexing.h"
+#include "catalog/pg_attrdef.h"
 #include "catalog/pg_attribute.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_constraint.h"
+#include "catalog/pg_depend.h"
+#include "catalog/pg_description.h"
+#include "catalog/pg_index.h"
+#include "catalog/pg_inherits.h"
+#include "catalog/pg_namespace.h"
+#include "catalog/pg_proc.h"
+#include "catalog/pg_rewrite.h"
+#include "catalog/pg_shdepend.h"
+#include "catalog/pg_statistic.h"
 #include "catalog/pg_trigger.h"
+#include "catalog/pg_type.h"
+#include "pgstat.h"
+#include "utils/builtins.h"
 #include "utils/lsyscache.h"
+#include "utils/typcache.h"
 
 
 /*
- * F_INT2EQ and F_OIDEQ definitions copied from
+ * F_INT2EQ, F_INT2GT, F_INT2GE, F_INT2LE and F_OIDEQ definitions copied from
  * backend/utils/fmgroids.h
  */
 #define F_INT2EQ 63
+#define F_INT2GT 146
+#define F_INT2LE 148
+#define F_INT2GE 151
 #define F_OIDEQ 184
 
 
 #include "catalog_funcs.h"
+#include "probes.h"
+#include "trace_funcs.h"
 
 
-HeapTuple catalog_fetch_tuple(Oid relation,
-							  Oid index,
-							  ScanKeyData *keys,
-							  int num_keys,
-							  Snapshot snapshot);
+static int catalog_scan(Oid relation,
+						Oid index,
+						ScanKeyData *keys,
+						int num_keys,
+						Snapshot snapshot,
+						CatalogRowCallback callback,
+						void *arg);
+static bool capture_one_row(CapturedRow *row, Oid relation, Oid index, ScanKeyData *keys, int num_keys, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+static void capture_rows_by_relid(CapturedRowArray *array, Oid relation, Oid index, AttrNumber attnum, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+static HeapTuple copy_catalog_tuple(HeapTuple tuple, Oid reltypeid);
 
 
-HeapTuple
-pgclass_fetch_tuple(Oid reloid, Snapshot snapshot)
+uint64 catalog_fetch_count = 0;
+
+
+/* What capture_row_callback() and capture_rows_callback() capture into. */
+typedef struct CaptureTarget {
+	Oid catalog;
+	EventCaptureLevel level;
+	MemoryContext mcxt;
+	CapturedRow *row;			/* for a single row */
+	CapturedRowArray *array;	/* for a set of rows */
+	int maxrows;				/* allocated length of array->rows */
+} CaptureTarget;
+
+
+/*
+ * The capture functions scan a catalog and capture the matching rows for an
+ * event at the given level while the scan is still open, so that the rows are
+ * only copied (into 'mcxt') at CAPTURE_FULL.  The single-row functions return
+ * false if there is no such row.
+ */
+bool
+pgclass_capture_row(CapturedRow *row, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
 {
-	Oid relation = RelationRelationId;
-	Oid index = ClassOidIndexId;
 	ScanKeyData keys[1];
 
 	/* Scan key is an Oid. */
@@ -52,15 +95,14 @@ pgclass_fetch_tuple(Oid reloid, Snapshot snapshot)
 				F_OIDEQ,
 				ObjectIdGetDatum(reloid));
 
-	return catalog_fetch_tuple(relation, index, keys, 1, snapshot);
+	return capture_one_row(row, RelationRelationId, ClassOidIndexId,
+						   keys, 1, snapshot, level, mcxt);
 }
 
 
-HeapTuple
-pgattribute_fetch_tuple(Oid reloid, int16 attnum, Snapshot snapshot)
+bool
+pgattribute_capture_row(CapturedRow *row, Oid reloid, int16 attnum, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
 {
-	Oid relation = AttributeRelationId;
-	Oid index = AttributeRelidNumIndexId;
 	ScanKeyData keys[2];
 
 	ScanKeyInit(&keys[0],
@@ -74,16 +116,15 @@ pgattribute_fetch_tuple(Oid reloid, int16 attnum, Snapshot snapshot)
 				BTEqualStrategyNumber,
 				F_INT2EQ,
 				Int16GetDatum(attnum));
-				
-	return catalog_fetch_tuple(relation, index, keys, 2, snapshot);
+
+	return capture_one_row(row, AttributeRelationId, AttributeRelidNumIndexId,
+						   keys, 2, snapshot, level, mcxt);
 }
 
 
-HeapTuple
-pgtrigger_fetch_tuple(Oid trigoid, Snapshot snapshot)
+bool
+pgtrigger_capture_row(CapturedRow *row, Oid trigoid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
 {
-	Oid relation = TriggerRelationId;
-	Oid index = TriggerOidIndexId;
 	ScanKeyData keys[1];
 
 	/* Scan key is an Oid. */
@@ -93,52 +134,445 @@ pgtrigger_fetch_tuple(Oid trigoid, Snapshot snapshot)
 				F_OIDEQ,
 				ObjectIdGetDatum(trigoid));
 
-	return catalog_fetch_tuple(relation, index, keys, 1, snapshot);
+	return capture_one_row(row, TriggerRelationId, TriggerOidIndexId,
+						   keys, 1, snapshot, level, mcxt);
+}
 
 
+/*
+ * Capture all of a relation's user columns (attnum > 0, including any dropped
+ * columns) in attnum order, using a single scan of pg_attribute.  At
+ * CAPTURE_OID nothing is kept, so pg_attribute isn't scanned at all.
+ */
+void
+pgattribute_capture_rows(CapturedRowArray *array, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
+{
+	capture_rows_by_relid(array, AttributeRelationId, AttributeRelidNumIndexId,
+						  Anum_pg_attribute_attrelid, reloid, snapshot, level, mcxt);
 }
 
 
 /*
- * Fetch a tuple from a system catalog given a suitable scan key.  The returned
- * HeapTuple is suitable for use with HeapTupleGetDatum(), and must be freed by
- * calling heap_freetuple().
+ * Capture a relation's column defaults, constraints, or indexes (as pg_index
+ * rows), each with a single scan.
  */
-HeapTuple
-catalog_fetch_tuple(Oid relation, Oid index, ScanKeyData *keys, int num_keys, Snapshot snapshot)
-{
-    Relation	reldesc;
-    SysScanDesc	relscan;
-    HeapTuple	reltuple;
-    Oid			reltypeid;
-	
-	/* Get the Oid of the relation's rowtype. */
-	reltypeid = get_rel_type_id(relation);
-	if (reltypeid == InvalidOid)
-		elog(ERROR, "catalog_fetch_tuple:  relation %u has no rowtype", relation);
-
-	/* Open the catalog relation and fetch a tuple using the given index. */
+void
+pgattrdef_capture_rows(CapturedRowArray *array, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
+{
+	capture_rows_by_relid(array, AttrDefaultRelationId, AttrDefaultIndexId,
+						  Anum_pg_attrdef_adrelid, reloid, snapshot, level, mcxt);
+}
+
+
+void
+pgconstraint_capture_rows(CapturedRowArray *array, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
+{
+	capture_rows_by_relid(array, ConstraintRelationId, ConstraintRelidIndexId,
+						  Anum_pg_constraint_conrelid, reloid, snapshot, level, mcxt);
+}
+
+
+void
+pgindex_capture_rows(CapturedRowArray *array, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
+{
+	capture_rows_by_relid(array, IndexRelationId, IndexIndrelidIndexId,
+						  Anum_pg_index_indrelid, reloid, snapshot, level, mcxt);
+}
+
+
+/*
+ * Call 'callback' for each of a relation's columns with attnums from 'first'
+ * to 'last' inclusive, in attnum order, using a single range scan of
+ * pg_attribute.  Columns which don't exist are simply skipped.  Pass 1 and
+ * MaxAttrNumber for all of the user columns.  Returns the number of rows.
+ */
+int
+pgattribute_scan_range(Oid reloid, int16 first, int16 last, Snapshot snapshot, CatalogRowCallback callback, void *arg)
+{
+	ScanKeyData keys[3];
+
+	ScanKeyInit(&keys[0],
+				Anum_pg_attribute_attrelid,
+				BTEqualStrategyNumber,
+				F_OIDEQ,
+				ObjectIdGetDatum(reloid));
+
+	ScanKeyInit(&keys[1],
+				Anum_pg_attribute_attnum,
+				BTGreaterEqualStrategyNumber,
+				F_INT2GE,
+				Int16GetDatum(first));
+
+	ScanKeyInit(&keys[2],
+				Anum_pg_attribute_attnum,
+				BTLessEqualStrategyNumber,
+				F_INT2LE,
+				Int16GetDatum(last));
+
+	return catalog_scan(AttributeRelationId, AttributeRelidNumIndexId,
+						keys, 3, snapshot, callback, arg);
+}
+
+
+static void
+capture_row_callback(HeapTuple tuple, void *arg)
+{
+	CaptureTarget *target = (CaptureTarget *) arg;
+	MemoryContext old_mcxt;
+
+	old_mcxt = MemoryContextSwitchTo(target->mcxt);
+	capture_catalog_row(target->row, target->catalog, tuple, target->level);
+	MemoryContextSwitchTo(old_mcxt);
+}
+
+
+static void
+capture_rows_callback(HeapTuple tuple, void *arg)
+{
+	CaptureTarget *target = (CaptureTarget *) arg;
+	CapturedRowArray *array = target->array;
+	MemoryContext old_mcxt;
+
+	old_mcxt = MemoryContextSwitchTo(target->mcxt);
+	if (array->nrows == target->maxrows)
+	{
+		target->maxrows = Max(8, target->maxrows * 2);
+		if (array->rows == NULL)
+			array->rows = (CapturedRow *) palloc(target->maxrows * sizeof(CapturedRow));
+		else
+			array->rows = (CapturedRow *) repalloc(array->rows, target->maxrows * sizeof(CapturedRow));
+	}
+	capture_catalog_row(&array->rows[array->nrows++], target->catalog, tuple, target->level);
+	MemoryContextSwitchTo(old_mcxt);
+}
+
+
+/* Capture the one row of a catalog matching the given scan keys. */
+static bool
+capture_one_row(CapturedRow *row, Oid relation, Oid index, ScanKeyData *keys, int num_keys, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
+{
+	CaptureTarget target;
+
+	memset(&target, 0, sizeof(target));
+	target.catalog = relation;
+	target.level = level;
+	target.mcxt = mcxt;
+	target.row = row;
+	return catalog_scan(relation, index, keys, num_keys, snapshot,
+						capture_row_callback, &target) > 0;
+}
+
+
+/*
+ * Capture the rows of a catalog whose leading index column 'attnum' is the
+ * given relation's Oid.
+ */
+static void
+capture_rows_by_relid(CapturedRowArray *array, Oid relation, Oid index, AttrNumber attnum, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt)
+{
+	CaptureTarget target;
+	ScanKeyData keys[1];
+
+	array->catalog = relation;
+	array->level = level;
+	array->nrows = 0;
+	array->rows = NULL;
+	if (level == CAPTURE_OID)
+		return;
+
+	ScanKeyInit(&keys[0],
+				attnum,
+				BTEqualStrategyNumber,
+				F_OIDEQ,
+				ObjectIdGetDatum(reloid));
+
+	memset(&target, 0, sizeof(target));
+	target.catalog = relation;
+	target.level = level;
+	target.mcxt = mcxt;
+	target.array = array;
+	catalog_scan(relation, index, keys, 1, snapshot, capture_rows_callback, &target);
+}
+
+
+/*
+ * Scan a system catalog with the given scan keys, calling 'callback' for each
+ * matching tuple (in index order, unless system indexes are being ignored)
+ * while the scan is open.  The tuple belongs to the scan, so the callback must
+ * copy anything it keeps.  Returns the number of tuples.
+ */
+static int
+catalog_scan(Oid relation, Oid index, ScanKeyData *keys, int num_keys, Snapshot snapshot, CatalogRowCallback callback, void *arg)
+{
+	Relation	reldesc;
+	SysScanDesc	relscan;
+	HeapTuple	reltuple;
+	int			ntuples = 0;
+	int			span;
+
+	TRACE_SCHEMA_TRIGGERS_CATALOG_FETCH_START(relation, index);
+	span = trace_span_begin("catalog_scan", "capture",
+							"\"catalog\": %u, \"index\": %u", relation, index);
+	catalog_fetch_count++;
 	reldesc = heap_open(relation, AccessShareLock);
 	relscan = systable_beginscan(reldesc,
 								 index,
 								 true,
 								 snapshot,
 								 num_keys, keys);
-	reltuple = systable_getnext(relscan);
-
-	/* Copy the tuple. */
-	if (!HeapTupleIsValid(reltuple))
-		goto finish;
-
-	/* Copy the tuple and ensure that the Datum headers are set. */
-	reltuple = heap_copytuple(reltuple);
-	HeapTupleHeaderSetDatumLength(reltuple->t_data, reltuple->t_len);
-	HeapTupleHeaderSetTypeId(reltuple->t_data, reltypeid);
-	HeapTupleHeaderSetTypMod(reltuple->t_data, -1);
-		
-finish:
-	/* Close the relation and return the copied tuple. */
+	while (HeapTupleIsValid(reltuple = systable_getnext(relscan)))
+	{
+		callback(reltuple, arg);
+		ntuples++;
+	}
+
 	systable_endscan(relscan);
 	heap_close(reldesc, AccessShareLock);
-	return reltuple;
+	trace_span_end(span);
+	TRACE_SCHEMA_TRIGGERS_CATALOG_FETCH_DONE(relation, index, ntuples);
+	return ntuples;
+}
+
+
+/*
+ * Copy a catalog tuple and ensure that the Datum headers are set, so that the
+ * copy is suitable for use with HeapTupleGetDatum().
+ */
+static HeapTuple
+copy_catalog_tuple(HeapTuple tuple, Oid reltypeid)
+{
+	HeapTuple copy;
+
+	copy = heap_copytuple(tuple);
+	HeapTupleHeaderSetDatumLength(copy->t_data, copy->t_len);
+	HeapTupleHeaderSetTypeId(copy->t_data, reltypeid);
+	HeapTupleHeaderSetTypMod(copy->t_data, -1);
+	return copy;
+}
+
+
+/*
+ * Capture a catalog row for an event at the given level, in the current
+ * memory context.  The tuple itself is left to the caller;  at CAPTURE_FULL a
+ * copy of it is kept.  Catalogs without a light form are captured in full at
+ * CAPTURE_LIGHT.
+ *
+ * The light fields of pg_class, pg_attribute and pg_trigger rows are filled in
+ * at every level, since they are kept inline;  the event's own code may use
+ * them (for instance for a column's fingerprint), but they are only shown to
+ * triggers which asked for them.
+ */
+void
+capture_catalog_row(CapturedRow *row, Oid catalog, HeapTuple tuple, EventCaptureLevel level)
+{
+	if (level == CAPTURE_LIGHT &&
+		catalog != RelationRelationId &&
+		catalog != AttributeRelationId &&
+		catalog != TriggerRelationId)
+		level = CAPTURE_FULL;
+
+	row->catalog = catalog;
+	row->oid = HeapTupleHeaderGetOid(tuple->t_data);
+	row->level = level;
+	row->tuple = NULL;
+	memset(&row->light, 0, sizeof(row->light));
+
+	if (level == CAPTURE_FULL)
+		row->tuple = copy_catalog_tuple(tuple, get_rel_type_id(catalog));
+
+	switch (catalog)
+	{
+		case RelationRelationId:
+		{
+			Form_pg_class form = (Form_pg_class) GETSTRUCT(tuple);
+			LightPgClass *light = &row->light.pg_class;
+
+			namecpy(&light->relname, &form->relname);
+			light->relnamespace = form->relnamespace;
+			light->relowner = form->relowner;
+			light->relkind = form->relkind;
+			light->relpersistence = form->relpersistence;
+			break;
+		}
+		case AttributeRelationId:
+		{
+			Form_pg_attribute form = (Form_pg_attribute) GETSTRUCT(tuple);
+			LightPgAttribute *light = &row->light.pg_attribute;
+
+			light->attrelid = form->attrelid;
+			namecpy(&light->attname, &form->attname);
+			light->atttypid = form->atttypid;
+			light->atttypmod = form->atttypmod;
+			light->attnum = form->attnum;
+			light->attnotnull = form->attnotnull;
+			light->attisdropped = form->attisdropped;
+			break;
+		}
+		case TriggerRelationId:
+		{
+			Form_pg_trigger form = (Form_pg_trigger) GETSTRUCT(tuple);
+			LightPgTrigger *light = &row->light.pg_trigger;
+
+			light->tgrelid = form->tgrelid;
+			namecpy(&light->tgname, &form->tgname);
+			light->tgfoid = form->tgfoid;
+			light->tgenabled = form->tgenabled;
+			light->tgisinternal = form->tgisinternal;
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+
+/*
+ * Copy a captured row for another event which wants it at the given level, in
+ * the current memory context.  The level mustn't be higher than the row's.
+ */
+void
+copy_captured_row(CapturedRow *dest, CapturedRow *src, EventCaptureLevel level)
+{
+	Assert(level <= src->level);
+
+	*dest = *src;
+	if (src->level == CAPTURE_FULL && level == CAPTURE_LIGHT &&
+		src->catalog != RelationRelationId &&
+		src->catalog != AttributeRelationId &&
+		src->catalog != TriggerRelationId)
+		level = CAPTURE_FULL;
+	dest->level = level;
+	dest->tuple = NULL;
+	if (level == CAPTURE_FULL)
+		dest->tuple = heap_copytuple(src->tuple);
+}
+
+
+/*
+ * Return a captured row as a HeapTuple suitable for HeapTupleGetDatum(), or
+ * NULL if only its Oid was captured.  At CAPTURE_LIGHT, a tuple of the
+ * catalog's rowtype is built in the current memory context, with all but the
+ * captured fields set to NULL.
+ */
+HeapTuple
+captured_row_tuple(CapturedRow *row)
+{
+	TupleDesc tupdesc;
+	Datum *values;
+	bool *nulls;
+	HeapTuple tuple;
+
+	if (row->level == CAPTURE_FULL)
+		return row->tuple;
+	if (row->level == CAPTURE_OID)
+		return NULL;
+
+	tupdesc = lookup_rowtype_tupdesc(get_rel_type_id(row->catalog), -1);
+	values = (Datum *) palloc0(tupdesc->natts * sizeof(Datum));
+	nulls = (bool *) palloc(tupdesc->natts * sizeof(bool));
+	memset(nulls, true, tupdesc->natts * sizeof(bool));
+
+#define SET_FIELD(anum, datum) \
+	(values[(anum) - 1] = (datum), nulls[(anum) - 1] = false)
+
+	switch (row->catalog)
+	{
+		case RelationRelationId:
+		{
+			LightPgClass *light = &row->light.pg_class;
+
+			SET_FIELD(Anum_pg_class_relname, NameGetDatum(&light->relname));
+			SET_FIELD(Anum_pg_class_relnamespace, ObjectIdGetDatum(light->relnamespace));
+			SET_FIELD(Anum_pg_class_relowner, ObjectIdGetDatum(light->relowner));
+			SET_FIELD(Anum_pg_class_relkind, CharGetDatum(light->relkind));
+			SET_FIELD(Anum_pg_class_relpersistence, CharGetDatum(light->relpersistence));
+			break;
+		}
+		case AttributeRelationId:
+		{
+			LightPgAttribute *light = &row->light.pg_attribute;
+
+			SET_FIELD(Anum_pg_attribute_attrelid, ObjectIdGetDatum(light->attrelid));
+			SET_FIELD(Anum_pg_attribute_attname, NameGetDatum(&light->attname));
+			SET_FIELD(Anum_pg_attribute_atttypid, ObjectIdGetDatum(light->atttypid));
+			SET_FIELD(Anum_pg_attribute_atttypmod, Int32GetDatum(light->atttypmod));
+			SET_FIELD(Anum_pg_attribute_attnum, Int16GetDatum(light->attnum));
+			SET_FIELD(Anum_pg_attribute_attnotnull, BoolGetDatum(light->attnotnull));
+			SET_FIELD(Anum_pg_attribute_attisdropped, BoolGetDatum(light->attisdropped));
+			break;
+		}
+		case TriggerRelationId:
+		{
+			LightPgTrigger *light = &row->light.pg_trigger;
+
+			SET_FIELD(Anum_pg_trigger_tgrelid, ObjectIdGetDatum(light->tgrelid));
+			SET_FIELD(Anum_pg_trigger_tgname, NameGetDatum(&light->tgname));
+			SET_FIELD(Anum_pg_trigger_tgfoid, ObjectIdGetDatum(light->tgfoid));
+			SET_FIELD(Anum_pg_trigger_tgenabled, CharGetDatum(light->tgenabled));
+			SET_FIELD(Anum_pg_trigger_tgisinternal, BoolGetDatum(light->tgisinternal));
+			break;
+		}
+		default:
+			elog(ERROR, "captured_row_tuple:  unsupported catalog %u", row->catalog);
+	}
+
+#undef SET_FIELD
+
+	tuple = heap_form_tuple(tupdesc, values, nulls);
+	if (tupdesc->tdhasoid)
+		HeapTupleSetOid(tuple, row->oid);
+	ReleaseTupleDesc(tupdesc);
+	pfree(values);
+	pfree(nulls);
+	return tuple;
+}
+
+
+/* The catalogs whose rows catalog_rows_written() counts. */
+static const Oid written_catalogs[] = {
+	RelationRelationId,
+	AttributeRelationId,
+	TypeRelationId,
+	ProcedureRelationId,
+	NamespaceRelationId,
+	AttrDefaultRelationId,
+	ConstraintRelationId,
+	IndexRelationId,
+	InheritsRelationId,
+	TriggerRelationId,
+	RewriteRelationId,
+	DependRelationId,
+	SharedDependRelationId,
+	DescriptionRelationId,
+	StatisticRelationId,
+};
+
+
+/*
+ * Number of rows this backend has inserted, updated or deleted in the
+ * catalogs DDL most often writes, from the counts pgstat keeps until they are
+ * reported (which is never in the middle of a statement).  Only the
+ * difference between two calls means anything;  it stays zero if
+ * track_counts is off.
+ */
+int64
+catalog_rows_written(void)
+{
+	int64 rows = 0;
+	int i;
+
+	for (i = 0; i < lengthof(written_catalogs); i++)
+	{
+		PgStat_TableStatus *tabentry = find_tabstat_entry(written_catalogs[i]);
+		PgStat_TableXactStatus *trans;
+
+		if (tabentry == NULL)
+			continue;
+		rows += tabentry->t_counts.t_tuples_inserted +
+			tabentry->t_counts.t_tuples_updated +
+			tabentry->t_counts.t_tuples_deleted;
+		for (trans = tabentry->trans; trans != NULL; trans = trans->upper)
+			rows += trans->tuples_inserted + trans->tuples_updated + trans->tuples_deleted;
+	}
+	return rows;
 }
@@ -14,12 +14,93 @@
 
 #include "postgres.h"
 #include "access/htup.h"
+#include "nodes/pg_list.h"
 #include "utils/snapshot.h"
 
 
-HeapTuple pgclass_fetch_tuple(Oid reloid, Snapshot snapshot);
-HeapTuple pgattribute_fetch_tuple(Oid reloid, int16 attnum, Snapshot snapshot);
-HeapTuple pgtrigger_fetch_tuple(Oid trigoid, Snapshot snapshot);
+/*
+ * How much of a catalog row is kept for an event.  Each event trigger asks for
+ * a level with WHEN capture IN ('oid' | 'light' | 'full'), and an event is
+ * captured at the highest level any of its enabled triggers asks for.
+ */
+typedef enum EventCaptureLevel {
+	CAPTURE_OID,				/* only the Oids naming the object */
+	CAPTURE_LIGHT,				/* plus a few fixed-size fields, kept inline */
+	CAPTURE_FULL				/* plus a copy of the whole row */
+} EventCaptureLevel;
+
+
+/* The fields kept at CAPTURE_LIGHT, for each catalog. */
+typedef struct LightPgClass {
+	NameData relname;
+	Oid relnamespace;
+	Oid relowner;
+	char relkind;
+	char relpersistence;
+} LightPgClass;
+
+typedef struct LightPgAttribute {
+	Oid attrelid;
+	NameData attname;
+	Oid atttypid;
+	int32 atttypmod;
+	int16 attnum;
+	bool attnotnull;
+	bool attisdropped;
+} LightPgAttribute;
+
+typedef struct LightPgTrigger {
+	Oid tgrelid;
+	NameData tgname;
+	Oid tgfoid;
+	char tgenabled;
+	bool tgisinternal;
+} LightPgTrigger;
+
+
+/* A catalog row as captured for an event. */
+typedef struct CapturedRow {
+	Oid catalog;				/* the catalog the row came from */
+	Oid oid;					/* the row's Oid, if the catalog has them */
+	EventCaptureLevel level;
+	HeapTuple tuple;			/* copy of the row, at CAPTURE_FULL */
+	union {
+		LightPgClass pg_class;
+		LightPgAttribute pg_attribute;
+		LightPgTrigger pg_trigger;
+	} light;
+} CapturedRow;
+
+
+/* A set of catalog rows captured for an event, such as a relation's columns. */
+typedef struct CapturedRowArray {
+	Oid catalog;				/* the catalog the rows came from */
+	EventCaptureLevel level;
+	int nrows;					/* no rows are kept at CAPTURE_OID */
+	CapturedRow *rows;
+} CapturedRowArray;
+
+
+/* Number of catalog scans this backend has made for its events. */
+extern uint64 catalog_fetch_count;
+
+
+/* Called for each row of a catalog scan, while the scan is still open. */
+typedef void (*CatalogRowCallback) (HeapTuple tuple, void *arg);
+
+
+bool pgclass_capture_row(CapturedRow *row, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+bool pgattribute_capture_row(CapturedRow *row, Oid reloid, int16 attnum, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+bool pgtrigger_capture_row(CapturedRow *row, Oid trigoid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+void pgattribute_capture_rows(CapturedRowArray *array, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+void pgattrdef_capture_rows(CapturedRowArray *array, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+void pgconstraint_capture_rows(CapturedRowArray *array, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+void pgindex_capture_rows(CapturedRowArray *array, Oid reloid, Snapshot snapshot, EventCaptureLevel level, MemoryContext mcxt);
+int pgattribute_scan_range(Oid reloid, int16 first, int16 last, Snapshot snapshot, CatalogRowCallback callback, void *arg);
+void capture_catalog_row(CapturedRow *row, Oid catalog, HeapTuple tuple, EventCaptureLevel level);
+void copy_captured_row(CapturedRow *dest, CapturedRow *src, EventCaptureLevel level);
+HeapTuple captured_row_tuple(CapturedRow *row);
+int64 catalog_rows_written(void);
 
 #if PG_VERSION_NUM < 90300
 #error "pg_schema_triggers are only supported on PostgreSQL 9.3 and up"
@@ -16,47 +16,210 @@
 #include "access/htup_details.h"
 #include "access/xact.h"
 #include "catalog/objectaccess.h"
+#include "catalog/pg_attrdef.h"
+#include "catalog/pg_attribute.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_constraint.h"
+#include "catalog/pg_index.h"
 #include "catalog/pg_trigger.h"
 #include "catalog/pg_type.h"
+#include "commands/event_trigger.h"
 #include "parser/parse_func.h"
 #include "storage/itemptr.h"
+#include "storage/lock.h"
 #include "tcop/utility.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
+#include "utils/syscache.h"
 #include "utils/tqual.h"
 
 
 #include "catalog_funcs.h"
 #include "events.h"
+#include "shmem_funcs.h"
 #include "trigger_funcs.h"
 
 
+static void captured_row_datum(CapturedRow *row, Datum *value, bool *isnull);
+static void captured_rows_datum(CapturedRowArray *array, Datum *value, bool *isnull);
+static void children_datum(EventInfo *info, Datum *value, bool *isnull);
+static bool collapse_column_event(const char *eventname, Oid rel);
+static bool suppress_event(const char *eventname, Oid rel, RelationChangeKind kind);
+static Oid trigger_relation(Oid trigoid, Snapshot snapshot);
+static CapturedRow *deferred_column_row(EventInfo *event, int16 *attnum);
+static void capture_new_column(EventInfo *event, CapturedRow *new);
+static void capture_new_columns_callback(HeapTuple tuple, void *arg);
+static void resolve_new_columns(EventInfo **events, int nevents);
+
+
+/*
+ * Convert a captured row to a composite Datum, which is NULL if only the
+ * row's Oid was captured.
+ */
+static void
+captured_row_datum(CapturedRow *row, Datum *value, bool *isnull)
+{
+	HeapTuple tuple = captured_row_tuple(row);
+
+	*isnull = !HeapTupleIsValid(tuple);
+	*value = HeapTupleIsValid(tuple) ? HeapTupleGetDatum(tuple) : (Datum) 0;
+}
+
+
+/*
+ * Convert captured rows to an array of composites, which is NULL if only the
+ * rows' Oids were captured.
+ */
+static void
+captured_rows_datum(CapturedRowArray *array, Datum *value, bool *isnull)
+{
+	Datum *elems;
+	int i;
+
+	*isnull = (array->level == CAPTURE_OID);
+	*value = (Datum) 0;
+	if (*isnull)
+		return;
+
+	elems = (Datum *) palloc(Max(array->nrows, 1) * sizeof(Datum));
+	for (i = 0; i < array->nrows; i++)
+		elems[i] = HeapTupleGetDatum(captured_row_tuple(&array->rows[i]));
+	*value = PointerGetDatum(construct_array(elems, array->nrows,
+											 get_rel_type_id(array->catalog),
+											 -1, false, 'd'));
+	pfree(elems);
+}
+
+
+/*
+ * Convert the relations whose events were collapsed into an event to a
+ * regclass array, which is NULL if there were none.
+ */
+static void
+children_datum(EventInfo *info, Datum *value, bool *isnull)
+{
+	Datum *elems;
+	ListCell *lc;
+	int i = 0;
+
+	*isnull = (info->children == NIL);
+	*value = (Datum) 0;
+	if (*isnull)
+		return;
+
+	elems = (Datum *) palloc(list_length(info->children) * sizeof(Datum));
+	foreach(lc, info->children)
+		elems[i++] = ObjectIdGetDatum(lfirst_oid(lc));
+	*value = PointerGetDatum(construct_array(elems, i, REGCLASSOID,
+											 sizeof(Oid), true, 'i'));
+	pfree(elems);
+}
+
+
+/*
+ * Collapse a column event on an inheritance child into its parent's event, if
+ * the event's triggers ask for that.  No catalog rows are fetched for the
+ * child, so its fingerprint is recomputed when next wanted.
+ */
+static bool
+collapse_column_event(const char *eventname, Oid rel)
+{
+	if (!CollapseChildEvent(eventname, rel))
+		return false;
+	record_relation_change(rel, RELATION_RESHAPED, 0);
+	return true;
+}
+
+
+/*
+ * Skip an event raised by a statement run from an event trigger, if none of
+ * the event's triggers want it;  see SuppressNestedEvent().  The change to
+ * the relation is still recorded, but nothing is captured for the event, so
+ * the relation's fingerprint is recomputed when next wanted if its columns
+ * changed.
+ */
+static bool
+suppress_event(const char *eventname, Oid rel, RelationChangeKind kind)
+{
+	if (!SuppressNestedEvent(eventname))
+		return false;
+	record_relation_change(rel, kind, 0);
+	return true;
+}
+
+
+/*
+ * Return the relation a trigger is on, reading it from the trigger's
+ * pg_trigger row without copying the row.
+ */
+static Oid
+trigger_relation(Oid trigoid, Snapshot snapshot)
+{
+	CapturedRow row;
+
+	if (!pgtrigger_capture_row(&row, trigoid, snapshot, CAPTURE_OID, CurrentMemoryContext))
+		elog(ERROR, "couldn't find pg_trigger row for oid=(%u)", trigoid);
+	return row.light.pg_trigger.tgrelid;
+}
+
+
 /*** Event:  relation_create ***/
 
 
 typedef struct RelationCreate_EventInfo {
 	EventInfo header;
 	Oid relation;
-	HeapTuple new;
+	CapturedRow new;
+	CapturedRowArray columns;
 } RelationCreate_EventInfo;
 
+static const EventFieldDesc relation_create_fields[] = {
+	{"new", EVENT_FIELD_ROW, offsetof(RelationCreate_EventInfo, new)},
+	{"columns", EVENT_FIELD_ROW_ARRAY, offsetof(RelationCreate_EventInfo, columns)},
+};
+
+static const EventInfoDesc relation_create_desc = {
+	"relation_create", sizeof(RelationCreate_EventInfo),
+	lengthof(relation_create_fields), relation_create_fields
+};
+
 
 void
 relation_create_event(Oid rel)
 {
 	RelationCreate_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("relation_create");
+	CapturedRow new;
+	CapturedRowArray columns;
+
+	/* The relation is described again once the statement has finished. */
+	RaiseAtStatementEnd(relation_create_complete_event, rel);
+
+	if (suppress_event("relation_create", rel, RELATION_CREATED))
+		return;
+
+	/*
+	 * Capture the new pg_class row and, unless only Oids are wanted, all of
+	 * the new pg_attribute rows in a single scan.  (No column_add events are
+	 * raised for the columns of a new relation.)
+	 */
+	if (!pgclass_capture_row(&new, rel, SnapshotSelf, level, EventMemoryContext()))
+		elog(ERROR, "couldn't find new pg_class row for oid=(%u)", rel);
+	pgattribute_capture_rows(&columns, rel, SnapshotSelf, level, EventMemoryContext());
 
 	/* Set up the event info. */
 	EnterEventMemoryContext();
-	info = (RelationCreate_EventInfo *)EventInfoAlloc("relation_create", sizeof(*info));
+	info = (RelationCreate_EventInfo *)EventInfoAlloc(&relation_create_desc);
+	info->header.relation = rel;
 	info->relation = rel;
-	info->new = pgclass_fetch_tuple(rel, SnapshotSelf);
+	info->new = new;
+	info->columns = columns;
 	LeaveEventMemoryContext();
-	if (!HeapTupleIsValid(info->new))
-		elog(ERROR, "couldn't find new pg_class row for oid=(%u)", rel);
+	record_relation_change(rel, RELATION_CREATED, 0);
 
 	/* Enqueue the event. */
 	EnqueueEvent((EventInfo*) info);
@@ -69,8 +232,8 @@ relation_create_eventinfo(PG_FUNCTION_ARGS)
 {
 	RelationCreate_EventInfo *info;
 	TupleDesc tupdesc;
-	Datum result[2];
-	bool result_isnull[2];
+	Datum result[3 + EVENTINFO_META_NATTS];
+	bool result_isnull[3 + EVENTINFO_META_NATTS];
 	HeapTuple tuple;
 	
 	/* Get the tupdesc for our return type. */
@@ -88,9 +251,113 @@ relation_create_eventinfo(PG_FUNCTION_ARGS)
 
 	/* Form and return the tuple. */
 	result[0] = ObjectIdGetDatum(info->relation);
-	result[1] = HeapTupleGetDatum(info->new);
 	result_isnull[0] = false;
-	result_isnull[1] = false;
+	captured_row_datum(&info->new, &result[1], &result_isnull[1]);
+	captured_rows_datum(&info->columns, &result[2], &result_isnull[2]);
+	EventInfoGetMetaDatums(&info->header, &result[3], &result_isnull[3]);
+	tuple = heap_form_tuple(tupdesc, result, result_isnull);
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+
+/*** Event:  relation_create_complete ***/
+
+
+typedef struct RelationCreateComplete_EventInfo {
+	EventInfo header;
+	Oid relation;
+	CapturedRow new;
+	CapturedRowArray columns;
+	CapturedRowArray defaults;
+	CapturedRowArray constraints;
+	CapturedRowArray indexes;
+} RelationCreateComplete_EventInfo;
+
+static const EventFieldDesc relation_create_complete_fields[] = {
+	{"new", EVENT_FIELD_ROW, offsetof(RelationCreateComplete_EventInfo, new)},
+	{"columns", EVENT_FIELD_ROW_ARRAY, offsetof(RelationCreateComplete_EventInfo, columns)},
+	{"defaults", EVENT_FIELD_ROW_ARRAY, offsetof(RelationCreateComplete_EventInfo, defaults)},
+	{"constraints", EVENT_FIELD_ROW_ARRAY, offsetof(RelationCreateComplete_EventInfo, constraints)},
+	{"indexes", EVENT_FIELD_ROW_ARRAY, offsetof(RelationCreateComplete_EventInfo, indexes)},
+};
+
+static const EventInfoDesc relation_create_complete_desc = {
+	"relation_create_complete", sizeof(RelationCreateComplete_EventInfo),
+	lengthof(relation_create_complete_fields), relation_create_complete_fields
+};
+
+
+/*
+ * Raised when a statement which created a relation ends, by which time the
+ * relation's constraints, defaults and indexes exist too.  Each catalog is
+ * scanned once for the relation.
+ */
+void
+relation_create_complete_event(Oid rel)
+{
+	RelationCreateComplete_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("relation_create_complete");
+	CapturedRow new;
+
+	if (SuppressNestedEvent("relation_create_complete"))
+		return;
+
+	/* The relation may have been dropped again by the same statement. */
+	if (!pgclass_capture_row(&new, rel, SnapshotSelf, level, EventMemoryContext()))
+	{
+		CancelEventCapture();
+		return;
+	}
+
+	/* Set up the event info, capturing as much of the rows as is wanted. */
+	EnterEventMemoryContext();
+	info = (RelationCreateComplete_EventInfo *)EventInfoAlloc(&relation_create_complete_desc);
+	info->header.relation = rel;
+	info->relation = rel;
+	info->new = new;
+	LeaveEventMemoryContext();
+	pgattribute_capture_rows(&info->columns, rel, SnapshotSelf, level, EventMemoryContext());
+	pgattrdef_capture_rows(&info->defaults, rel, SnapshotSelf, level, EventMemoryContext());
+	pgconstraint_capture_rows(&info->constraints, rel, SnapshotSelf, level, EventMemoryContext());
+	pgindex_capture_rows(&info->indexes, rel, SnapshotSelf, level, EventMemoryContext());
+
+	/* Enqueue the event. */
+	EnqueueEvent((EventInfo*) info);
+}
+
+
+PG_FUNCTION_INFO_V1(relation_create_complete_eventinfo);
+Datum
+relation_create_complete_eventinfo(PG_FUNCTION_ARGS)
+{
+	RelationCreateComplete_EventInfo *info;
+	TupleDesc tupdesc;
+	Datum result[6 + EVENTINFO_META_NATTS];
+	bool result_isnull[6 + EVENTINFO_META_NATTS];
+	HeapTuple tuple;
+	
+	/* Get the tupdesc for our return type. */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+				        "that cannot accept type record")));
+	BlessTupleDesc(tupdesc);
+	Assert(tupdesc->natts == sizeof result / sizeof result[0]);
+	Assert(tupdesc->natts == sizeof result_isnull / sizeof result_isnull[0]);
+
+	/* Get our EventInfo struct. */
+	info = (RelationCreateComplete_EventInfo *)GetCurrentEvent("relation_create_complete");
+
+	/* Form and return the tuple. */
+	result[0] = ObjectIdGetDatum(info->relation);
+	result_isnull[0] = false;
+	captured_row_datum(&info->new, &result[1], &result_isnull[1]);
+	captured_rows_datum(&info->columns, &result[2], &result_isnull[2]);
+	captured_rows_datum(&info->defaults, &result[3], &result_isnull[3]);
+	captured_rows_datum(&info->constraints, &result[4], &result_isnull[4]);
+	captured_rows_datum(&info->indexes, &result[5], &result_isnull[5]);
+	EventInfoGetMetaDatums(&info->header, &result[6], &result_isnull[6]);
 	tuple = heap_form_tuple(tupdesc, result, result_isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
@@ -102,32 +369,54 @@ relation_create_eventinfo(PG_FUNCTION_ARGS)
 typedef struct RelationAlter_EventInfo {
 	EventInfo header;
 	Oid relation;
-	HeapTuple old;
-	HeapTuple new;
+	CapturedRow old;
+	CapturedRow new;
 } RelationAlter_EventInfo;
 
+static const EventFieldDesc relation_alter_fields[] = {
+	{"old", EVENT_FIELD_ROW, offsetof(RelationAlter_EventInfo, old)},
+	{"new", EVENT_FIELD_ROW, offsetof(RelationAlter_EventInfo, new)},
+};
+
+static const EventInfoDesc relation_alter_desc = {
+	"relation_alter", sizeof(RelationAlter_EventInfo),
+	lengthof(relation_alter_fields), relation_alter_fields
+};
+
 
 void
 relation_alter_event(Oid rel)
 {
 	RelationAlter_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("relation_alter");
+	CapturedRow old;
+	CapturedRow new;
+	Snapshot snapshot;
 
-	/* Set up the event info and save the old and new pg_class rows. */
-	EnterEventMemoryContext();
-	info = (RelationAlter_EventInfo *)EventInfoAlloc("relation_alter", sizeof(*info));
-	info->relation = rel;
+	if (suppress_event("relation_alter", rel, RELATION_ALTERED))
+		return;
+
+	/* Capture the old and new pg_class rows. */
 #if PG_VERSION_NUM < 90400
-	info->old = pgclass_fetch_tuple(rel, SnapshotNow);
+	snapshot = SnapshotNow;
 #else
-	info->old = pgclass_fetch_tuple(rel, GetCatalogSnapshot(rel));
+	snapshot = GetCatalogSnapshot(rel);
 #endif
-	info->new = pgclass_fetch_tuple(rel, SnapshotSelf);
-	LeaveEventMemoryContext();
-	if (!HeapTupleIsValid(info->old))
+	if (!pgclass_capture_row(&old, rel, snapshot, level, EventMemoryContext()))
 		elog(ERROR, "couldn't find old pg_class row for oid=(%u)", rel);
-	if (!HeapTupleIsValid(info->new))
+	if (!pgclass_capture_row(&new, rel, SnapshotSelf, level, EventMemoryContext()))
 		elog(ERROR, "couldn't find new pg_class row for oid=(%u)", rel);
 
+	/* Set up the event info. */
+	EnterEventMemoryContext();
+	info = (RelationAlter_EventInfo *)EventInfoAlloc(&relation_alter_desc);
+	info->header.relation = rel;
+	info->relation = rel;
+	info->old = old;
+	info->new = new;
+	LeaveEventMemoryContext();
+	record_relation_change(rel, RELATION_ALTERED, 0);
+
 	/* Enqueue the event. */
 	EnqueueEvent((EventInfo*) info);
 }
@@ -139,8 +428,8 @@ relation_alter_eventinfo(PG_FUNCTION_ARGS)
 {
 	RelationAlter_EventInfo *info;
 	TupleDesc tupdesc;
-	Datum result[3];
-	bool result_isnull[3];
+	Datum result[3 + EVENTINFO_META_NATTS];
+	bool result_isnull[3 + EVENTINFO_META_NATTS];
 	HeapTuple tuple;
 	
 	/* Get the tupdesc for our return type. */
@@ -158,11 +447,183 @@ relation_alter_eventinfo(PG_FUNCTION_ARGS)
 
 	/* Form and return the tuple. */
 	result[0] = ObjectIdGetDatum(info->relation);
-	result[1] = HeapTupleGetDatum(info->old);
-	result[2] = HeapTupleGetDatum(info->new);
 	result_isnull[0] = false;
-	result_isnull[1] = false;
-	result_isnull[2] = false;
+	captured_row_datum(&info->old, &result[1], &result_isnull[1]);
+	captured_row_datum(&info->new, &result[2], &result_isnull[2]);
+	EventInfoGetMetaDatums(&info->header, &result[3], &result_isnull[3]);
+	tuple = heap_form_tuple(tupdesc, result, result_isnull);
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+
+/*** Event:  relation_rewrite ***/
+
+
+/*
+ * Raised when ALTER TABLE is about to rewrite a relation, before any of it is
+ * copied, and fired at once rather than when the statement ends, so that a
+ * trigger can refuse an expensive rewrite by raising an error.  PostgreSQL
+ * 9.5 added the table_rewrite event for this;  the extension script creates
+ * an event trigger on it which calls relation_rewrite_guard().
+ */
+typedef struct RelationRewrite_EventInfo {
+	EventInfo header;
+	Oid relation;
+	CapturedRow new;
+	int32 relpages;
+	float4 reltuples;
+	int64 size;
+	int32 reason;
+} RelationRewrite_EventInfo;
+
+static const EventFieldDesc relation_rewrite_fields[] = {
+	{"new", EVENT_FIELD_ROW, offsetof(RelationRewrite_EventInfo, new)},
+	{"relpages", EVENT_FIELD_INT32, offsetof(RelationRewrite_EventInfo, relpages)},
+	{"reltuples", EVENT_FIELD_FLOAT4, offsetof(RelationRewrite_EventInfo, reltuples)},
+	{"size", EVENT_FIELD_INT64, offsetof(RelationRewrite_EventInfo, size)},
+	{"reason", EVENT_FIELD_INT32, offsetof(RelationRewrite_EventInfo, reason)},
+};
+
+static const EventInfoDesc relation_rewrite_desc = {
+	"relation_rewrite", sizeof(RelationRewrite_EventInfo),
+	lengthof(relation_rewrite_fields), relation_rewrite_fields
+};
+
+
+void
+relation_rewrite_event(Oid rel, int reason)
+{
+	RelationRewrite_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("relation_rewrite");
+	CapturedRow new;
+	HeapTuple classTup;
+	Form_pg_class classForm;
+	int64 size;
+
+	if (SuppressNestedEvent("relation_rewrite"))
+		return;
+
+	/*
+	 * Capture the pg_class row, as ALTER TABLE has left it so far.  The
+	 * planner's estimates are read from the syscache rather than from a copy
+	 * of the row;  the size is that of the files the rewrite replaces,
+	 * including the TOAST table and indexes.
+	 */
+	if (!pgclass_capture_row(&new, rel, SnapshotSelf, level, EventMemoryContext()))
+		elog(ERROR, "couldn't find pg_class row for oid=(%u)", rel);
+	classTup = SearchSysCache1(RELOID, ObjectIdGetDatum(rel));
+	if (!HeapTupleIsValid(classTup))
+		elog(ERROR, "cache lookup failed for relation %u", rel);
+	classForm = (Form_pg_class) GETSTRUCT(classTup);
+	size = DatumGetInt64(DirectFunctionCall1(pg_total_relation_size,
+											 ObjectIdGetDatum(rel)));
+
+	/* Set up the event info. */
+	EnterEventMemoryContext();
+	info = (RelationRewrite_EventInfo *)EventInfoAlloc(&relation_rewrite_desc);
+	info->header.relation = rel;
+	info->relation = rel;
+	info->relpages = classForm->relpages;
+	info->reltuples = classForm->reltuples;
+	info->size = size;
+	info->reason = reason;
+	info->new = new;
+	LeaveEventMemoryContext();
+	ReleaseSysCache(classTup);
+
+	/* Fire the event now, while the rewrite can still be stopped. */
+	FireEvent((EventInfo*) info);
+}
+
+
+/*
+ * The table_rewrite event trigger function, which raises relation_rewrite.
+ * Statements that began before the library was loaded have no event context,
+ * and their rewrites are let through.
+ */
+PG_FUNCTION_INFO_V1(relation_rewrite_guard);
+Datum
+relation_rewrite_guard(PG_FUNCTION_ARGS)
+{
+#if PG_VERSION_NUM >= 90500
+	Oid rel;
+	int reason;
+
+	if (!CALLED_AS_EVENT_TRIGGER(fcinfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_E_R_I_E_EVENT_TRIGGER_PROTOCOL_VIOLATED),
+				 errmsg("relation_rewrite_guard() must be called as an event trigger")));
+
+	if (GetEventContextCount() > 0)
+	{
+		rel = DatumGetObjectId(OidFunctionCall0(F_PG_EVENT_TRIGGER_TABLE_REWRITE_OID));
+		reason = DatumGetInt32(OidFunctionCall0(F_PG_EVENT_TRIGGER_TABLE_REWRITE_REASON));
+		relation_rewrite_event(rel, reason);
+	}
+	PG_RETURN_VOID();
+#else
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("the relation_rewrite event requires PostgreSQL 9.5 or later")));
+	PG_RETURN_VOID();
+#endif
+}
+
+
+/* The reasons for a rewrite, as the names of the AT_REWRITE_* flags set. */
+static Datum
+rewrite_reasons_datum(int reason)
+{
+	Datum elems[4];
+	int nelems = 0;
+
+#if PG_VERSION_NUM >= 90500
+	if (reason & AT_REWRITE_ALTER_PERSISTENCE)
+		elems[nelems++] = CStringGetTextDatum("persistence");
+	if (reason & AT_REWRITE_DEFAULT_VAL)
+		elems[nelems++] = CStringGetTextDatum("default");
+	if (reason & AT_REWRITE_COLUMN_REWRITE)
+		elems[nelems++] = CStringGetTextDatum("column_type");
+	if (reason & AT_REWRITE_ALTER_OID)
+		elems[nelems++] = CStringGetTextDatum("oids");
+#endif
+	return PointerGetDatum(construct_array(elems, nelems, TEXTOID, -1, false, 'i'));
+}
+
+
+PG_FUNCTION_INFO_V1(relation_rewrite_eventinfo);
+Datum
+relation_rewrite_eventinfo(PG_FUNCTION_ARGS)
+{
+	RelationRewrite_EventInfo *info;
+	TupleDesc tupdesc;
+	Datum result[7 + EVENTINFO_META_NATTS];
+	bool result_isnull[7 + EVENTINFO_META_NATTS];
+	HeapTuple tuple;
+	
+	/* Get the tupdesc for our return type. */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+				        "that cannot accept type record")));
+	BlessTupleDesc(tupdesc);
+	Assert(tupdesc->natts == sizeof result / sizeof result[0]);
+	Assert(tupdesc->natts == sizeof result_isnull / sizeof result_isnull[0]);
+
+	/* Get our EventInfo struct. */
+	info = (RelationRewrite_EventInfo *)GetCurrentEvent("relation_rewrite");
+
+	/* Form and return the tuple. */
+	memset(result_isnull, 0, sizeof result_isnull);
+	result[0] = ObjectIdGetDatum(info->relation);
+	captured_row_datum(&info->new, &result[1], &result_isnull[1]);
+	result[2] = Int32GetDatum(info->relpages);
+	result[3] = Float4GetDatum(info->reltuples);
+	result[4] = Int64GetDatum(info->size);
+	result[5] = Int32GetDatum(info->reason);
+	result[6] = rewrite_reasons_datum(info->reason);
+	EventInfoGetMetaDatums(&info->header, &result[7], &result_isnull[7]);
 	tuple = heap_form_tuple(tupdesc, result, result_isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
@@ -174,28 +635,51 @@ relation_alter_eventinfo(PG_FUNCTION_ARGS)
 typedef struct RelationDrop_EventInfo {
 	EventInfo header;
 	Oid relation;
-	HeapTuple old;
+	CapturedRow old;
 } RelationDrop_EventInfo;
 
+static const EventFieldDesc relation_drop_fields[] = {
+	{"old", EVENT_FIELD_ROW, offsetof(RelationDrop_EventInfo, old)},
+};
+
+static const EventInfoDesc relation_drop_desc = {
+	"relation_drop", sizeof(RelationDrop_EventInfo),
+	lengthof(relation_drop_fields), relation_drop_fields
+};
+
 
 void
 relation_drop_event(Oid rel)
 {
 	RelationDrop_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("relation_drop");
+	CapturedRow old;
+	Snapshot snapshot;
 
-	/* Set up the event info and save the old pg_class row. */
-	EnterEventMemoryContext();
-	info = (RelationDrop_EventInfo *)EventInfoAlloc("relation_drop", sizeof(*info));
-	info->relation = rel;
+	/* Capture any of the relation's deferred column rows before they go. */
+	ResolveEventCaptures(rel, 0);
+
+	if (suppress_event("relation_drop", rel, RELATION_DROPPED))
+		return;
+
+	/* Capture the old pg_class row. */
 #if PG_VERSION_NUM < 90400
-	info->old = pgclass_fetch_tuple(rel, SnapshotNow);
+	snapshot = SnapshotNow;
 #else
-	info->old = pgclass_fetch_tuple(rel, GetCatalogSnapshot(rel));
+	snapshot = GetCatalogSnapshot(rel);
 #endif
-	LeaveEventMemoryContext();
-	if (!HeapTupleIsValid(info->old))
+	if (!pgclass_capture_row(&old, rel, snapshot, level, EventMemoryContext()))
 		elog(ERROR, "couldn't find old pg_class row for oid=(%u)", rel);
 
+	/* Set up the event info. */
+	EnterEventMemoryContext();
+	info = (RelationDrop_EventInfo *)EventInfoAlloc(&relation_drop_desc);
+	info->header.relation = rel;
+	info->relation = rel;
+	info->old = old;
+	LeaveEventMemoryContext();
+	record_relation_change(rel, RELATION_DROPPED, 0);
+
 	/* Enqueue the event. */
 	EnqueueEvent((EventInfo*) info);
 }
@@ -207,8 +691,8 @@ relation_drop_eventinfo(PG_FUNCTION_ARGS)
 {
 	RelationDrop_EventInfo *info;
 	TupleDesc tupdesc;
-	Datum result[2];
-	bool result_isnull[2];
+	Datum result[2 + EVENTINFO_META_NATTS];
+	bool result_isnull[2 + EVENTINFO_META_NATTS];
 	HeapTuple tuple;
 	
 	/* Get the tupdesc for our return type. */
@@ -226,9 +710,9 @@ relation_drop_eventinfo(PG_FUNCTION_ARGS)
 
 	/* Form and return the tuple. */
 	result[0] = ObjectIdGetDatum(info->relation);
-	result[1] = HeapTupleGetDatum(info->old);
 	result_isnull[0] = false;
-	result_isnull[1] = false;
+	captured_row_datum(&info->old, &result[1], &result_isnull[1]);
+	EventInfoGetMetaDatums(&info->header, &result[2], &result_isnull[2]);
 	tuple = heap_form_tuple(tupdesc, result, result_isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
@@ -241,24 +725,41 @@ typedef struct ColumnAdd_EventInfo {
 	EventInfo header;
 	Oid relation;
 	int16 attnum;
-	HeapTuple new;
+	CapturedRow new;
 } ColumnAdd_EventInfo;
 
+static const EventFieldDesc column_add_fields[] = {
+	{"attnum", EVENT_FIELD_INT16, offsetof(ColumnAdd_EventInfo, attnum)},
+	{"new", EVENT_FIELD_ROW, offsetof(ColumnAdd_EventInfo, new)},
+};
+
+static const EventInfoDesc column_add_desc = {
+	"column_add", sizeof(ColumnAdd_EventInfo),
+	lengthof(column_add_fields), column_add_fields,
+	resolve_new_columns, true
+};
+
 
 void
 column_add_event(Oid rel, int16 attnum)
 {
 	ColumnAdd_EventInfo *info;
 
-	/* Set up the event info and save the new pg_attr row. */
-	EnterEventMemoryContext();
-	info = (ColumnAdd_EventInfo *)EventInfoAlloc("column_add", sizeof(*info));
+	if (suppress_event("column_add", rel, RELATION_RESHAPED) ||
+		collapse_column_event("column_add", rel))
+		return;
+
+	/*
+	 * Set up the event info.  The new pg_attribute row is fetched later,
+	 * together with those of the statement's other column events;  see
+	 * resolve_new_columns().
+	 */
+	info = (ColumnAdd_EventInfo *)EventInfoAlloc(&column_add_desc);
+	info->header.relation = rel;
 	info->relation = rel;
 	info->attnum = attnum;
-	info->new = pgattribute_fetch_tuple(rel, attnum, SnapshotSelf);
-	LeaveEventMemoryContext();
-	if (!HeapTupleIsValid(info->new))
-		elog(ERROR, "couldn't find new pg_attribute row for oid,attnum=(%u,%d)", rel, attnum);
+	info->new.level = GetEventCaptureLevel("column_add");
+	DeferEventCapture((EventInfo *) info, attnum);
 
 	/* Enqueue the event. */
 	EnqueueEvent((EventInfo*) info);
@@ -271,8 +772,8 @@ column_add_eventinfo(PG_FUNCTION_ARGS)
 {
 	ColumnAdd_EventInfo *info;
 	TupleDesc tupdesc;
-	Datum result[3];
-	bool result_isnull[3];
+	Datum result[4 + EVENTINFO_META_NATTS];
+	bool result_isnull[4 + EVENTINFO_META_NATTS];
 	HeapTuple tuple;
 	
 	/* Get the tupdesc for our return type. */
@@ -291,10 +792,11 @@ column_add_eventinfo(PG_FUNCTION_ARGS)
 	/* Form and return the tuple. */
 	result[0] = ObjectIdGetDatum(info->relation);
 	result[1] = Int16GetDatum(info->attnum);
-	result[2] = HeapTupleGetDatum(info->new);
 	result_isnull[0] = false;
 	result_isnull[1] = false;
-	result_isnull[2] = false;
+	captured_row_datum(&info->new, &result[2], &result_isnull[2]);
+	children_datum(&info->header, &result[3], &result_isnull[3]);
+	EventInfoGetMetaDatums(&info->header, &result[4], &result_isnull[4]);
 	tuple = heap_form_tuple(tupdesc, result, result_isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
@@ -307,32 +809,81 @@ typedef struct ColumnAlter_EventInfo {
 	EventInfo header;
 	Oid relation;
 	int16 attnum;
-	HeapTuple old;
-	HeapTuple new;
+	CapturedRow old;
+	CapturedRow new;
 } ColumnAlter_EventInfo;
 
+static const EventFieldDesc column_alter_fields[] = {
+	{"attnum", EVENT_FIELD_INT16, offsetof(ColumnAlter_EventInfo, attnum)},
+	{"old", EVENT_FIELD_ROW, offsetof(ColumnAlter_EventInfo, old)},
+	{"new", EVENT_FIELD_ROW, offsetof(ColumnAlter_EventInfo, new)},
+};
+
+static const EventInfoDesc column_alter_desc = {
+	"column_alter", sizeof(ColumnAlter_EventInfo),
+	lengthof(column_alter_fields), column_alter_fields,
+	resolve_new_columns, true
+};
+
 
 void
 column_alter_event(Oid rel, int16 attnum)
 {
 	ColumnAlter_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("column_alter");
+	EventCaptureLevel old_level = level;
+	EventInfo *earlier;
+	CapturedRow old;
+	Snapshot snapshot;
+
+	/*
+	 * If an earlier event of this statement is still waiting for this
+	 * column's new row, this event's old row is the one it wants, so this
+	 * event can't be collapsed without fetching it.
+	 */
+	earlier = TakeDeferredCapture(rel, attnum);
+	if (earlier == NULL &&
+		(suppress_event("column_alter", rel, RELATION_RESHAPED) ||
+		 collapse_column_event("column_alter", rel)))
+		return;
+
+	/*
+	 * Capture the old pg_attribute row, at the earlier event's level if that
+	 * is higher than this one's.
+	 */
+	if (earlier != NULL)
+		old_level = Max(level, deferred_column_row(earlier, NULL)->level);
+#if PG_VERSION_NUM < 90400
+	snapshot = SnapshotNow;
+#else
+	snapshot = GetCatalogSnapshot(rel);
+#endif
+	if (!pgattribute_capture_row(&old, rel, attnum, snapshot, old_level, EventMemoryContext()))
+		elog(ERROR, "couldn't find old pg_attr row for oid,attnum=(%u,%d)", rel, attnum);
+	if (earlier != NULL)
+		capture_new_column(earlier, &old);
 
-	/* Set up the event info and save the old and new pg_attr rows. */
+	/*
+	 * Set up the event info.  The new row is captured later;  see
+	 * resolve_new_columns().
+	 */
 	EnterEventMemoryContext();
-	info = (ColumnAlter_EventInfo *)EventInfoAlloc("column_alter", sizeof(*info));
+	info = (ColumnAlter_EventInfo *)EventInfoAlloc(&column_alter_desc);
+	info->header.relation = rel;
 	info->relation = rel;
 	info->attnum = attnum;
-#if PG_VERSION_NUM < 90400
-	info->old = pgattribute_fetch_tuple(rel, attnum, SnapshotNow);
-#else
-	info->old = pgattribute_fetch_tuple(rel, attnum, GetCatalogSnapshot(rel));
-#endif
-	info->new = pgattribute_fetch_tuple(rel, attnum, SnapshotSelf);
+	if (earlier == NULL)
+		info->old = old;
+	else
+	{
+		copy_captured_row(&info->old, &old, level);
+		if (old.tuple != NULL)
+			heap_freetuple(old.tuple);
+	}
+	info->new.level = level;
 	LeaveEventMemoryContext();
-	if (!HeapTupleIsValid(info->old))
-		elog(ERROR, "couldn't find old pg_attr row for oid,attnum=(%u,%d)", rel, attnum);
-	if (!HeapTupleIsValid(info->new))
-		elog(ERROR, "couldn't find new pg_attr row for oid,attnum=(%u,%d)", rel, attnum);
+	record_relation_change(rel, RELATION_ALTERED, column_fingerprint(&old.light.pg_attribute));
+	DeferEventCapture((EventInfo *) info, attnum);
 
 	/* Enqueue the event. */
 	EnqueueEvent((EventInfo*) info);
@@ -345,8 +896,8 @@ column_alter_eventinfo(PG_FUNCTION_ARGS)
 {
 	ColumnAlter_EventInfo *info;
 	TupleDesc tupdesc;
-	Datum result[4];
-	bool result_isnull[4];
+	Datum result[5 + EVENTINFO_META_NATTS];
+	bool result_isnull[5 + EVENTINFO_META_NATTS];
 	HeapTuple tuple;
 	
 	/* Get the tupdesc for our return type. */
@@ -365,17 +916,169 @@ column_alter_eventinfo(PG_FUNCTION_ARGS)
 	/* Form and return the tuple. */
 	result[0] = ObjectIdGetDatum(info->relation);
 	result[1] = Int16GetDatum(info->attnum);
-	result[2] = HeapTupleGetDatum(info->old);
-	result[3] = HeapTupleGetDatum(info->new);
 	result_isnull[0] = false;
 	result_isnull[1] = false;
-	result_isnull[2] = false;
-	result_isnull[3] = false;
+	captured_row_datum(&info->old, &result[2], &result_isnull[2]);
+	captured_row_datum(&info->new, &result[3], &result_isnull[3]);
+	children_datum(&info->header, &result[4], &result_isnull[4]);
+	EventInfoGetMetaDatums(&info->header, &result[5], &result_isnull[5]);
 	tuple = heap_form_tuple(tupdesc, result, result_isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
 
 
+/*** Deferred capture of new pg_attribute rows ***/
+
+
+/*
+ * Return the deferred new row of a column_add or column_alter event, and the
+ * column's attnum unless 'attnum' is NULL.
+ */
+static CapturedRow *
+deferred_column_row(EventInfo *event, int16 *attnum)
+{
+	if (event->desc == &column_add_desc)
+	{
+		ColumnAdd_EventInfo *info = (ColumnAdd_EventInfo *) event;
+
+		if (attnum != NULL)
+			*attnum = info->attnum;
+		return &info->new;
+	}
+	if (event->desc == &column_alter_desc)
+	{
+		ColumnAlter_EventInfo *info = (ColumnAlter_EventInfo *) event;
+
+		if (attnum != NULL)
+			*attnum = info->attnum;
+		return &info->new;
+	}
+	elog(ERROR, "deferred_column_row:  unexpected event \"%s\"", event->eventname);
+	return NULL;				/* keep compiler quiet */
+}
+
+
+/*
+ * Complete a column event's deferred new row from a row captured for another
+ * event, and count the row towards the relation's fingerprint.
+ */
+static void
+capture_new_column(EventInfo *event, CapturedRow *new)
+{
+	CapturedRow *row;
+
+	row = deferred_column_row(event, NULL);
+	EnterEventMemoryContext();
+	copy_captured_row(row, new, row->level);
+	LeaveEventMemoryContext();
+	record_relation_change(event->relation, RELATION_ALTERED,
+						   column_fingerprint(&new->light.pg_attribute));
+}
+
+
+/* The column events of one relation which resolve_new_columns() completes. */
+typedef struct NewColumnScan {
+	EventInfo **events;
+	int16 first;				/* lowest attnum wanted */
+	int *waiting;				/* first event waiting for each attnum */
+	int *next;					/* next event waiting for the same attnum */
+} NewColumnScan;
+
+
+/*
+ * Complete the deferred new rows of the events waiting for a column, from the
+ * tuple of a pg_attribute scan.
+ */
+static void
+capture_new_columns_callback(HeapTuple tuple, void *arg)
+{
+	NewColumnScan *scan = (NewColumnScan *) arg;
+	int16 attnum = ((Form_pg_attribute) GETSTRUCT(tuple))->attnum;
+	int j;
+
+	for (j = scan->waiting[attnum - scan->first]; j >= 0; j = scan->next[j])
+	{
+		EventInfo *event = scan->events[j];
+		CapturedRow *row = deferred_column_row(event, NULL);
+
+		EnterEventMemoryContext();
+		capture_catalog_row(row, AttributeRelationId, tuple, row->level);
+		LeaveEventMemoryContext();
+		record_relation_change(event->relation, RELATION_ALTERED,
+							   column_fingerprint(&row->light.pg_attribute));
+		scan->events[j] = NULL;
+	}
+}
+
+
+/*
+ * Resolve function for column_add and column_alter events.  Rather than
+ * fetching each column's row with its own index scan, the rows wanted from
+ * each relation are captured with a single range scan over its attnums, so a
+ * statement adding or altering hundreds of columns scans pg_attribute once.
+ * The entries of 'events' are set to NULL as they are completed.
+ */
+static void
+resolve_new_columns(EventInfo **events, int nevents)
+{
+	NewColumnScan scan;
+	int i;
+	int j;
+
+	scan.events = events;
+	scan.next = (int *) palloc(nevents * sizeof(int));
+	for (i = 0; i < nevents; i++)
+	{
+		Oid rel;
+		int16 attnum;
+		int16 first;
+		int16 last;
+
+		if (events[i] == NULL)
+			continue;
+		rel = events[i]->relation;
+
+		/* Find the range of columns wanted from this relation. */
+		deferred_column_row(events[i], &first);
+		last = first;
+		for (j = i + 1; j < nevents; j++)
+		{
+			if (events[j] == NULL || events[j]->relation != rel)
+				continue;
+			deferred_column_row(events[j], &attnum);
+			first = Min(first, attnum);
+			last = Max(last, attnum);
+		}
+
+		/* Chain the events waiting for each column, in order. */
+		scan.first = first;
+		scan.waiting = (int *) palloc((last - first + 1) * sizeof(int));
+		memset(scan.waiting, -1, (last - first + 1) * sizeof(int));
+		for (j = nevents - 1; j >= i; j--)
+		{
+			if (events[j] == NULL || events[j]->relation != rel)
+				continue;
+			deferred_column_row(events[j], &attnum);
+			scan.next[j] = scan.waiting[attnum - first];
+			scan.waiting[attnum - first] = j;
+		}
+
+		/* Capture the rows, completing each of the relation's events. */
+		pgattribute_scan_range(rel, first, last, SnapshotSelf,
+							   capture_new_columns_callback, &scan);
+		for (j = i; j < nevents; j++)
+		{
+			if (events[j] == NULL || events[j]->relation != rel)
+				continue;
+			deferred_column_row(events[j], &attnum);
+			elog(ERROR, "couldn't find new pg_attribute row for oid,attnum=(%u,%d)", rel, attnum);
+		}
+		pfree(scan.waiting);
+	}
+	pfree(scan.next);
+}
+
+
 /*** Event:  column_drop ***/
 
 
@@ -383,29 +1086,55 @@ typedef struct ColumnDrop_EventInfo {
 	EventInfo header;
 	Oid relation;
 	int16 attnum;
-	HeapTuple old;
+	CapturedRow old;
 } ColumnDrop_EventInfo;
 
+static const EventFieldDesc column_drop_fields[] = {
+	{"attnum", EVENT_FIELD_INT16, offsetof(ColumnDrop_EventInfo, attnum)},
+	{"old", EVENT_FIELD_ROW, offsetof(ColumnDrop_EventInfo, old)},
+};
+
+static const EventInfoDesc column_drop_desc = {
+	"column_drop", sizeof(ColumnDrop_EventInfo),
+	lengthof(column_drop_fields), column_drop_fields,
+	NULL, true
+};
+
 
 void
 column_drop_event(Oid rel, int16 attnum)
 {
 	ColumnDrop_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("column_drop");
+	CapturedRow old;
+	Snapshot snapshot;
 
-	/* Set up the event info and save the old and new pg_attr rows. */
-	EnterEventMemoryContext();
-	info = (ColumnDrop_EventInfo *)EventInfoAlloc("column_drop", sizeof(*info));
-	info->relation = rel;
-	info->attnum = attnum;
+	/* Capture the column's deferred new row, if any, before it goes. */
+	ResolveEventCaptures(rel, attnum);
+
+	if (suppress_event("column_drop", rel, RELATION_RESHAPED) ||
+		collapse_column_event("column_drop", rel))
+		return;
+
+	/* Capture the old pg_attribute row. */
 #if PG_VERSION_NUM < 90400
-	info->old = pgattribute_fetch_tuple(rel, attnum, SnapshotNow);
+	snapshot = SnapshotNow;
 #else
-	info->old = pgattribute_fetch_tuple(rel, attnum, GetCatalogSnapshot(rel));
+	snapshot = GetCatalogSnapshot(rel);
 #endif
-	LeaveEventMemoryContext();
-	if (!HeapTupleIsValid(info->old))
+	if (!pgattribute_capture_row(&old, rel, attnum, snapshot, level, EventMemoryContext()))
 		elog(ERROR, "couldn't find old pg_attribute row for oid,attnum=(%u,%d)", rel, attnum);
 
+	/* Set up the event info. */
+	EnterEventMemoryContext();
+	info = (ColumnDrop_EventInfo *)EventInfoAlloc(&column_drop_desc);
+	info->header.relation = rel;
+	info->relation = rel;
+	info->attnum = attnum;
+	info->old = old;
+	LeaveEventMemoryContext();
+	record_relation_change(rel, RELATION_ALTERED, column_fingerprint(&old.light.pg_attribute));
+
 	/* Enqueue the event. */
 	EnqueueEvent((EventInfo*) info);
 }
@@ -417,8 +1146,8 @@ column_drop_eventinfo(PG_FUNCTION_ARGS)
 {
 	ColumnDrop_EventInfo *info;
 	TupleDesc tupdesc;
-	Datum result[3];
-	bool result_isnull[3];
+	Datum result[4 + EVENTINFO_META_NATTS];
+	bool result_isnull[4 + EVENTINFO_META_NATTS];
 	HeapTuple tuple;
 	
 	/* Get the tupdesc for our return type. */
@@ -437,10 +1166,11 @@ column_drop_eventinfo(PG_FUNCTION_ARGS)
 	/* Form and return the tuple. */
 	result[0] = ObjectIdGetDatum(info->relation);
 	result[1] = Int16GetDatum(info->attnum);
-	result[2] = HeapTupleGetDatum(info->old);
 	result_isnull[0] = false;
 	result_isnull[1] = false;
-	result_isnull[2] = false;
+	captured_row_datum(&info->old, &result[2], &result_isnull[2]);
+	children_datum(&info->header, &result[3], &result_isnull[3]);
+	EventInfoGetMetaDatums(&info->header, &result[4], &result_isnull[4]);
 	tuple = heap_form_tuple(tupdesc, result, result_isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
@@ -453,24 +1183,51 @@ typedef struct TriggerCreate_EventInfo {
 	EventInfo header;
 	Oid trigger_oid;
 	bool is_internal;
-	HeapTuple new;
+	CapturedRow new;
 } TriggerCreate_EventInfo;
 
+static const EventFieldDesc trigger_create_fields[] = {
+	{"trigger_oid", EVENT_FIELD_OID, offsetof(TriggerCreate_EventInfo, trigger_oid)},
+	{"is_internal", EVENT_FIELD_BOOL, offsetof(TriggerCreate_EventInfo, is_internal)},
+	{"new", EVENT_FIELD_ROW, offsetof(TriggerCreate_EventInfo, new)},
+};
+
+static const EventInfoDesc trigger_create_desc = {
+	"trigger_create", sizeof(TriggerCreate_EventInfo),
+	lengthof(trigger_create_fields), trigger_create_fields
+};
+
 
 void
 trigger_create_event(Oid trigoid, bool is_internal)
 {
 	TriggerCreate_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("trigger_create");
+	CapturedRow new;
+
+	/*
+	 * Only the trigger's relation is needed for a suppressed event, so don't
+	 * capture its row first.
+	 */
+	if (SuppressNestedEvent("trigger_create"))
+	{
+		record_relation_change(trigger_relation(trigoid, SnapshotSelf), RELATION_ALTERED, 0);
+		return;
+	}
+
+	/* Capture the new pg_trigger row. */
+	if (!pgtrigger_capture_row(&new, trigoid, SnapshotSelf, level, EventMemoryContext()))
+		elog(ERROR, "couldn't find new pg_trigger row for oid=(%u)", trigoid);
 
 	/* Set up the event info. */
 	EnterEventMemoryContext();
-	info = (TriggerCreate_EventInfo *)EventInfoAlloc("trigger_create", sizeof(*info));
+	info = (TriggerCreate_EventInfo *)EventInfoAlloc(&trigger_create_desc);
+	info->header.relation = new.light.pg_trigger.tgrelid;
 	info->trigger_oid = trigoid;
 	info->is_internal = is_internal;
-	info->new = pgtrigger_fetch_tuple(trigoid, SnapshotSelf);
+	info->new = new;
 	LeaveEventMemoryContext();
-	if (!HeapTupleIsValid(info->new))
-		elog(ERROR, "couldn't find new pg_trigger row for oid=(%u)", trigoid);
+	record_relation_change(info->header.relation, RELATION_ALTERED, 0);
 
 	/* Enqueue the event. */
 	EnqueueEvent((EventInfo*) info);
@@ -483,8 +1240,8 @@ trigger_create_eventinfo(PG_FUNCTION_ARGS)
 {
 	TriggerCreate_EventInfo *info;
 	TupleDesc tupdesc;
-	Datum result[3];
-	bool result_isnull[3];
+	Datum result[3 + EVENTINFO_META_NATTS];
+	bool result_isnull[3 + EVENTINFO_META_NATTS];
 	HeapTuple tuple;
 	
 	/* Get the tupdesc for our return type. */
@@ -503,10 +1260,10 @@ trigger_create_eventinfo(PG_FUNCTION_ARGS)
 	/* Form and return the tuple. */
 	result[0] = ObjectIdGetDatum(info->trigger_oid);
 	result[1] = BoolGetDatum(info->is_internal);
-	result[2] = HeapTupleGetDatum(info->new);
 	result_isnull[0] = false;
 	result_isnull[1] = false;
-	result_isnull[2] = false;
+	captured_row_datum(&info->new, &result[2], &result_isnull[2]);
+	EventInfoGetMetaDatums(&info->header, &result[3], &result_isnull[3]);
 	tuple = heap_form_tuple(tupdesc, result, result_isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
@@ -544,28 +1301,56 @@ trigger_alter_event(Oid trigoid)
 typedef struct TriggerDrop_EventInfo {
 	EventInfo header;
 	Oid trigger_oid;
-	HeapTuple old;
+	CapturedRow old;
 } TriggerDrop_EventInfo;
 
+static const EventFieldDesc trigger_drop_fields[] = {
+	{"trigger_oid", EVENT_FIELD_OID, offsetof(TriggerDrop_EventInfo, trigger_oid)},
+	{"old", EVENT_FIELD_ROW, offsetof(TriggerDrop_EventInfo, old)},
+};
+
+static const EventInfoDesc trigger_drop_desc = {
+	"trigger_drop", sizeof(TriggerDrop_EventInfo),
+	lengthof(trigger_drop_fields), trigger_drop_fields
+};
+
 
 void
 trigger_drop_event(Oid trigoid)
 {
 	TriggerDrop_EventInfo *info;
+	EventCaptureLevel level = GetEventCaptureLevel("trigger_drop");
+	CapturedRow old;
+	Snapshot snapshot;
 
-	/* Set up the event info and save the old pg_trigger row. */
-	EnterEventMemoryContext();
-	info = (TriggerDrop_EventInfo *)EventInfoAlloc("trigger_drop", sizeof(*info));
-	info->trigger_oid = trigoid;
 #if PG_VERSION_NUM < 90400
-	info->old = pgtrigger_fetch_tuple(trigoid, SnapshotNow);
+	snapshot = SnapshotNow;
 #else
-	info->old = pgtrigger_fetch_tuple(trigoid, GetCatalogSnapshot(trigoid));
+	snapshot = GetCatalogSnapshot(trigoid);
 #endif
-	LeaveEventMemoryContext();
-	if (!HeapTupleIsValid(info->old))
+	/*
+	 * Only the trigger's relation is needed for a suppressed event, so don't
+	 * capture its row first.
+	 */
+	if (SuppressNestedEvent("trigger_drop"))
+	{
+		record_relation_change(trigger_relation(trigoid, snapshot), RELATION_ALTERED, 0);
+		return;
+	}
+
+	/* Capture the old pg_trigger row. */
+	if (!pgtrigger_capture_row(&old, trigoid, snapshot, level, EventMemoryContext()))
 		elog(ERROR, "couldn't find old pg_trigger row for oid=(%u)", trigoid);
 
+	/* Set up the event info. */
+	EnterEventMemoryContext();
+	info = (TriggerDrop_EventInfo *)EventInfoAlloc(&trigger_drop_desc);
+	info->header.relation = old.light.pg_trigger.tgrelid;
+	info->trigger_oid = trigoid;
+	info->old = old;
+	LeaveEventMemoryContext();
+	record_relation_change(info->header.relation, RELATION_ALTERED, 0);
+
 	/* Enqueue the event. */
 	EnqueueEvent((EventInfo*) info);
 }
@@ -577,8 +1362,8 @@ trigger_drop_eventinfo(PG_FUNCTION_ARGS)
 {
 	TriggerDrop_EventInfo *info;
 	TupleDesc tupdesc;
-	Datum result[2];
-	bool result_isnull[2];
+	Datum result[2 + EVENTINFO_META_NATTS];
+	bool result_isnull[2 + EVENTINFO_META_NATTS];
 	HeapTuple tuple;
 	
 	/* Get the tupdesc for our return type. */
@@ -596,9 +1381,224 @@ trigger_drop_eventinfo(PG_FUNCTION_ARGS)
 
 	/* Form and return the tuple. */
 	result[0] = ObjectIdGetDatum(info->trigger_oid);
-	result[1] = HeapTupleGetDatum(info->old);
+	result_isnull[0] = false;
+	captured_row_datum(&info->old, &result[1], &result_isnull[1]);
+	EventInfoGetMetaDatums(&info->header, &result[2], &result_isnull[2]);
+	tuple = heap_form_tuple(tupdesc, result, result_isnull);
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+
+
+/*** Event:  ddl_statement_end ***/
+
+
+/*
+ * Raised when a DDL statement has done its work, after all of its other
+ * events, with what the statement took.  It is only measured while some
+ * trigger is enabled on the event.
+ */
+typedef struct DdlStatementEnd_EventInfo {
+	EventInfo header;
+	double elapsed;
+	double lock_wait;
+	Oid lock_relation;
+	int32 lock_mode;
+	int32 events;
+	int64 catalog_rows;
+} DdlStatementEnd_EventInfo;
+
+static const EventFieldDesc ddl_statement_end_fields[] = {
+	{"elapsed", EVENT_FIELD_FLOAT8, offsetof(DdlStatementEnd_EventInfo, elapsed)},
+	{"lock_wait", EVENT_FIELD_FLOAT8, offsetof(DdlStatementEnd_EventInfo, lock_wait)},
+	{"lock_relation", EVENT_FIELD_OID, offsetof(DdlStatementEnd_EventInfo, lock_relation)},
+	{"lock_mode", EVENT_FIELD_INT32, offsetof(DdlStatementEnd_EventInfo, lock_mode)},
+	{"events", EVENT_FIELD_INT32, offsetof(DdlStatementEnd_EventInfo, events)},
+	{"catalog_rows", EVENT_FIELD_INT64, offsetof(DdlStatementEnd_EventInfo, catalog_rows)},
+};
+
+static const EventInfoDesc ddl_statement_end_desc = {
+	"ddl_statement_end", sizeof(DdlStatementEnd_EventInfo),
+	lengthof(ddl_statement_end_fields), ddl_statement_end_fields
+};
+
+
+void
+ddl_statement_end_event(const StatementCost *cost)
+{
+	DdlStatementEnd_EventInfo *info;
+
+	if (SuppressNestedEvent("ddl_statement_end"))
+		return;
+
+	EnterEventMemoryContext();
+	info = (DdlStatementEnd_EventInfo *)EventInfoAlloc(&ddl_statement_end_desc);
+	info->elapsed = cost->elapsed;
+	info->lock_wait = cost->lock_wait;
+	info->lock_relation = cost->lock_relation;
+	info->lock_mode = cost->lock_mode;
+	info->events = cost->events;
+	info->catalog_rows = cost->catalog_rows;
+	LeaveEventMemoryContext();
+
+	/* Enqueue the event. */
+	EnqueueEvent((EventInfo*) info);
+}
+
+
+PG_FUNCTION_INFO_V1(ddl_statement_end_eventinfo);
+Datum
+ddl_statement_end_eventinfo(PG_FUNCTION_ARGS)
+{
+	DdlStatementEnd_EventInfo *info;
+	TupleDesc tupdesc;
+	Datum result[6 + EVENTINFO_META_NATTS];
+	bool result_isnull[6 + EVENTINFO_META_NATTS];
+	HeapTuple tuple;
+	
+	/* Get the tupdesc for our return type. */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+				        "that cannot accept type record")));
+	BlessTupleDesc(tupdesc);
+	Assert(tupdesc->natts == sizeof result / sizeof result[0]);
+	Assert(tupdesc->natts == sizeof result_isnull / sizeof result_isnull[0]);
+
+	/* Get our EventInfo struct. */
+	info = (DdlStatementEnd_EventInfo *)GetCurrentEvent("ddl_statement_end");
+
+	/* Form and return the tuple;  the lock is NULL if there were no waits. */
+	memset(result_isnull, 0, sizeof result_isnull);
+	result[0] = Float8GetDatum(info->elapsed);
+	result[1] = Float8GetDatum(info->lock_wait);
+	result[2] = ObjectIdGetDatum(info->lock_relation);
+	result_isnull[2] = !OidIsValid(info->lock_relation);
+	if (info->lock_mode != NoLock)
+		result[3] = CStringGetTextDatum(GetLockmodeName(DEFAULT_LOCKMETHOD, info->lock_mode));
+	else
+		result_isnull[3] = true;
+	result[4] = Int32GetDatum(info->events);
+	result[5] = Int64GetDatum(info->catalog_rows);
+	EventInfoGetMetaDatums(&info->header, &result[6], &result_isnull[6]);
+	tuple = heap_form_tuple(tupdesc, result, result_isnull);
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+
+
+/*** Finding an event's description by name ***/
+
+
+static const EventInfoDesc *event_descs[] = {
+	&relation_create_desc,
+	&relation_create_complete_desc,
+	&relation_alter_desc,
+	&relation_rewrite_desc,
+	&relation_drop_desc,
+	&column_add_desc,
+	&column_alter_desc,
+	&column_drop_desc,
+	&trigger_create_desc,
+	&trigger_drop_desc,
+	&ddl_statement_end_desc,
+};
+
+
+/*
+ * Return the EventInfoDesc of the named event, or NULL if the event has no
+ * EventInfo.
+ */
+const EventInfoDesc *
+lookup_event_desc(const char *eventname)
+{
+	int i;
+
+	for (i = 0; i < lengthof(event_descs); i++)
+		if (strcmp(event_descs[i]->eventname, eventname) == 0)
+			return event_descs[i];
+	return NULL;
+}
+
+
+/*** Metadata common to all events ***/
+
+
+PG_FUNCTION_INFO_V1(current_event_meta);
+Datum
+current_event_meta(PG_FUNCTION_ARGS)
+{
+	EventInfo *info;
+	TupleDesc tupdesc;
+	Datum result[2 + EVENTINFO_META_NATTS];
+	bool result_isnull[2 + EVENTINFO_META_NATTS];
+	HeapTuple tuple;
+
+	/* Get the tupdesc for our return type. */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+				        "that cannot accept type record")));
+	BlessTupleDesc(tupdesc);
+	Assert(tupdesc->natts == sizeof result / sizeof result[0]);
+	Assert(tupdesc->natts == sizeof result_isnull / sizeof result_isnull[0]);
+
+	/* Get the EventInfo struct, whatever the event. */
+	info = GetCurrentEvent(NULL);
+
+	/* Form and return the tuple. */
+	result[0] = CStringGetTextDatum(info->eventname);
+	result[1] = ObjectIdGetDatum(info->relation);
 	result_isnull[0] = false;
 	result_isnull[1] = false;
+	EventInfoGetMetaDatums(info, &result[2], &result_isnull[2]);
 	tuple = heap_form_tuple(tupdesc, result, result_isnull);
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
+
+
+PG_FUNCTION_INFO_V1(current_command);
+Datum
+current_command(PG_FUNCTION_ARGS)
+{
+	const EventCommand *command;
+	TupleDesc tupdesc;
+	Datum result[2];
+	bool result_isnull[2];
+	HeapTuple tuple;
+
+	/* Get the tupdesc for our return type. */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+				        "that cannot accept type record")));
+	BlessTupleDesc(tupdesc);
+	Assert(tupdesc->natts == sizeof result / sizeof result[0]);
+	Assert(tupdesc->natts == sizeof result_isnull / sizeof result_isnull[0]);
+
+	/* Get the command, whatever the event. */
+	command = GetCurrentCommand();
+
+	/* Form and return the tuple. */
+	result[0] = CStringGetTextDatum(command->tag);
+	result_isnull[0] = false;
+	result[1] = command->query ? CStringGetTextDatum(command->query) : (Datum) 0;
+	result_isnull[1] = (command->query == NULL);
+	tuple = heap_form_tuple(tupdesc, result, result_isnull);
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
+
+
+/*
+ * The number of statements in this session whose event contexts are still
+ * allocated;  zero outside any utility statement, unless one was leaked.
+ */
+PG_FUNCTION_INFO_V1(event_context_count);
+Datum
+event_context_count(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT32(GetEventContextCount());
+}
@@ -16,12 +16,22 @@
 #include "fmgr.h"
 
 
+#include "trigger_funcs.h"
+
+
 void relation_create_event(Oid rel);
 Datum relation_create_eventinfo(PG_FUNCTION_ARGS);
 
+void relation_create_complete_event(Oid rel);
+Datum relation_create_complete_eventinfo(PG_FUNCTION_ARGS);
+
 void relation_alter_event(Oid rel);
 Datum relation_alter_eventinfo(PG_FUNCTION_ARGS);
 
+void relation_rewrite_event(Oid rel, int reason);
+Datum relation_rewrite_guard(PG_FUNCTION_ARGS);
+Datum relation_rewrite_eventinfo(PG_FUNCTION_ARGS);
+
 void relation_drop_event(Oid rel);
 Datum relation_drop_eventinfo(PG_FUNCTION_ARGS);
 
@@ -42,5 +52,14 @@ void trigger_alter_event(Oid trigoid);
 void trigger_drop_event(Oid trigoid);
 Datum trigger_drop_eventinfo(PG_FUNCTION_ARGS);
 
+void ddl_statement_end_event(const StatementCost *cost);
+Datum ddl_statement_end_eventinfo(PG_FUNCTION_ARGS);
+
+const EventInfoDesc *lookup_event_desc(const char *eventname);
+
+Datum current_event_meta(PG_FUNCTION_ARGS);
+Datum current_command(PG_FUNCTION_ARGS);
+Datum event_context_count(PG_FUNCTION_ARGS);
+
 
 #endif	/* SCHEMA_TRIGGERS_EVENTS_H */
@@ -0,0 +1,146 @@
+/*
+ * Dry runs of DDL, reporting the events a statement would raise and what
+ * firing them would take, without running any event triggers or keeping any
+ * of the statement's changes.
+ *
+ * The statement is run through SPI in a subtransaction, with a dry run of
+ * the event triggers in progress (see BeginDryRun());  its events are
+ * captured and queued as usual, and summed up instead of being fired when it
+ * ends.  The subtransaction is then rolled back.
+ *
+ * pg_schema_triggers/explain_funcs.c
+ */
+
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "access/xact.h"
+#include "catalog/pg_type.h"
+#include "executor/spi.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
+
+
+#include "explain_funcs.h"
+#include "trigger_funcs.h"
+
+
+static List *dry_run_ddl(const char *ddl);
+
+
+/*
+ * SQL-callable function returning, for each event the given DDL would
+ * raise, the number of events, the triggers they would fire and the number
+ * of calls, and the catalog scans, capture time (in milliseconds) and queue
+ * memory they take.
+ */
+PG_FUNCTION_INFO_V1(explain_ddl);
+Datum
+explain_ddl(PG_FUNCTION_ARGS)
+{
+	char *ddl = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext old_mcontext;
+	List *events;
+	ListCell *lc;
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo) ||
+		!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	/* Build the result in the per-query context, where it must outlive us. */
+	old_mcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupdesc = CreateTupleDescCopy(tupdesc);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(old_mcontext);
+
+	events = dry_run_ddl(ddl);
+	foreach(lc, events)
+	{
+		DryRunEvent *event = (DryRunEvent *) lfirst(lc);
+		Datum *triggers;
+		Datum values[7];
+		bool nulls[7];
+		ListCell *lc2;
+		int i = 0;
+
+		triggers = (Datum *) palloc((list_length(event->triggers) + 1) * sizeof(Datum));
+		foreach(lc2, event->triggers)
+			triggers[i++] = CStringGetTextDatum((char *) lfirst(lc2));
+
+		memset(nulls, false, sizeof(nulls));
+		values[0] = CStringGetTextDatum(event->eventname);
+		values[1] = Int64GetDatum(event->events);
+		values[2] = PointerGetDatum(construct_array(triggers, i, TEXTOID, -1, false, 'i'));
+		values[3] = Int64GetDatum(event->trigger_calls);
+		values[4] = Int64GetDatum(event->catalog_fetches);
+		values[5] = Float8GetDatum(event->capture_time);
+		values[6] = Int64GetDatum(event->queue_bytes);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+	return (Datum) 0;
+}
+
+
+/*
+ * Run the DDL in a subtransaction with a dry run in progress, roll it back,
+ * and return the dry run's DryRunEvents.  An error raised by the DDL is
+ * raised again once the subtransaction has been rolled back.
+ */
+static List *
+dry_run_ddl(const char *ddl)
+{
+	MemoryContext mcontext = CurrentMemoryContext;
+	ResourceOwner owner = CurrentResourceOwner;
+	List *events;
+
+	BeginDryRun(mcontext);
+	BeginInternalSubTransaction(NULL);
+	MemoryContextSwitchTo(mcontext);
+
+	PG_TRY();
+	{
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "SPI_connect failed");
+		if (SPI_execute(ddl, false, 0) < 0)
+			elog(ERROR, "SPI_execute failed for \"%s\"", ddl);
+		SPI_finish();
+
+		RollbackAndReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(mcontext);
+		CurrentResourceOwner = owner;
+	}
+	PG_CATCH();
+	{
+		ErrorData *edata;
+
+		MemoryContextSwitchTo(mcontext);
+		edata = CopyErrorData();
+		FlushErrorState();
+
+		RollbackAndReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(mcontext);
+		CurrentResourceOwner = owner;
+
+		EndDryRun();
+		ReThrowError(edata);
+	}
+	PG_END_TRY();
+
+	events = EndDryRun();
+	return events;
+}
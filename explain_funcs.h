@@ -0,0 +1,22 @@
+/*-------------------------------------------------------------------------
+ *
+ * explain_funcs.h
+ *    Declarations for dry runs of DDL.
+ *
+ *
+ * pg_schema_triggers/explain_funcs.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_EXPLAIN_FUNCS_H
+#define SCHEMA_TRIGGERS_EXPLAIN_FUNCS_H
+
+
+#include "postgres.h"
+#include "fmgr.h"
+
+
+Datum explain_ddl(PG_FUNCTION_ARGS);
+
+
+#endif	/* SCHEMA_TRIGGERS_EXPLAIN_FUNCS_H */
@@ -10,11 +10,16 @@
 #include "catalog/dependency.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_event_trigger.h"
 #include "catalog/pg_trigger.h"
 #include "utils/builtins.h"
 
 #include "events.h"
 #include "hook_objacc.h"
+#include "probes.h"
+#include "shmem_funcs.h"
+#include "trace_funcs.h"
+#include "trigger_funcs.h"
 
 
 static object_access_hook_type old_objectaccess_hook = NULL;
@@ -30,33 +35,26 @@ static void on_drop(Oid classId, Oid objectId, int subId, ObjectAccessDrop *args
 
 
 /*
- * Install our objectaccess hook.
- *
- * We react poorly if we discover another module has also installed an
- * objectaccess hook.
+ * Install our objectaccess hook, chaining to any hook installed before us
+ * (such as sepgsql's).
  */
 void
 install_objacc_hook()
 {
-	if (object_access_hook != NULL)
-		elog(FATAL, "an object_access hook is already installed.");
 	old_objectaccess_hook = object_access_hook;
 	object_access_hook = objectaccess_hook;
 }
 
 
 /*
- * Remove our objectaccess hook.
- *
- * We react poorly if we discover another module has already removed
- * our hook.
+ * Remove our objectaccess hook, unless a module loaded after us has chained
+ * to it.
  */
 void
 remove_objacc_hook()
 {
-	if (object_access_hook != objectaccess_hook)
-		elog(FATAL, "hook conflict, our object_access hook has been removed.");
-	object_access_hook = old_objectaccess_hook;
+	if (object_access_hook == objectaccess_hook)
+		object_access_hook = old_objectaccess_hook;
 }
 
 
@@ -75,10 +73,22 @@ objectaccess_hook(ObjectAccessType access,
 	int subId,
 	void *arg)
 {
+	int span;
+
+	/* Let the previous hook (perhaps an access control check) go first. */
+	if (old_objectaccess_hook)
+		old_objectaccess_hook(access, classId, objectId, subId, arg);
+
+	TRACE_SCHEMA_TRIGGERS_OBJECTACCESS(access, classId, objectId, subId);
+
 	switch (access)
 	{
 		case OAT_POST_CREATE:
+			span = trace_span_begin("post_create", "hook",
+									"\"class\": %u, \"object\": %u, \"subid\": %d",
+									classId, objectId, subId);
 			on_create(classId, objectId, subId, (ObjectAccessPostCreate *)arg);
+			trace_span_end(span);
 			break;
 
 		/*
@@ -89,11 +99,19 @@ objectaccess_hook(ObjectAccessType access,
 		 *   RenameRelationInternal		RelationRelationId	pg_class.oid	0
 		 */
 		case OAT_POST_ALTER:
+			span = trace_span_begin("post_alter", "hook",
+									"\"class\": %u, \"object\": %u, \"subid\": %d",
+									classId, objectId, subId);
 			on_alter(classId, objectId, subId, (ObjectAccessPostAlter *)arg);
+			trace_span_end(span);
 			break;
 
 		case OAT_DROP:
+			span = trace_span_begin("drop", "hook",
+									"\"class\": %u, \"object\": %u, \"subid\": %d",
+									classId, objectId, subId);
 			on_drop(classId, objectId, subId, (ObjectAccessDrop *)arg);
+			trace_span_end(span);
 			break;
 
 		case OAT_NAMESPACE_SEARCH:
@@ -113,12 +131,14 @@ on_create(Oid classId, Oid objectId, int subId, ObjectAccessPostCreate *args)
 	switch (classId)
 	{
 		case RelationRelationId:
+			BeginEventCapture();
 			if (subId == 0)
 				relation_create_event(objectId);
 			else
 				column_add_event(objectId, subId);
 			break;
 		case TriggerRelationId:
+			BeginEventCapture();
 			trigger_create_event(objectId, args->is_internal);
 			break;
 	}
@@ -134,6 +154,7 @@ on_alter(Oid classId, Oid objectId, int subId, ObjectAccessPostAlter *args)
 	switch (classId)
 	{
 		case RelationRelationId:
+			BeginEventCapture();
 			if (subId == 0)
 				relation_alter_event(objectId);
 			else
@@ -155,13 +176,18 @@ on_drop(Oid classId, Oid objectId, int subId, ObjectAccessDrop *args)
 	switch (classId)
 	{
 		case RelationRelationId:
+			BeginEventCapture();
 			if (subId == 0)
 				relation_drop_event(objectId);
 			else
 				column_drop_event(objectId, subId);
 			break;
 		case TriggerRelationId:
+			BeginEventCapture();
 			trigger_drop_event(objectId);
 			break;
+		case EventTriggerRelationId:
+			forget_trigger_stats(objectId);
+			break;
 	}
 }
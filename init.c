@@ -15,13 +15,22 @@
 #include "catalog/objectaddress.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
+#include "commands/extension.h"
 #include "parser/parse_func.h"
 #include "tcop/utility.h"
 #include "utils/builtins.h"
+#include "utils/guc.h"
 #include "utils/lsyscache.h"
 
 #include "events.h"
 #include "hook_objacc.h"
+#include "lockwait_funcs.h"
+#include "notify_funcs.h"
+#include "probes.h"
+#include "queue_funcs.h"
+#include "record_funcs.h"
+#include "shmem_funcs.h"
+#include "trace_funcs.h"
 #include "trigger_funcs.h"
 
 
@@ -45,29 +54,146 @@ static void utility_hook(Node *parsetree,
 /*
  * Install and uninstall the hook.
  *
- * We react poorly if we discover another module has also installed a
- * ProcessUtility hook.
+ * Other modules (pg_stat_statements, auto_explain, sepgsql...) may have
+ * installed hooks before us, or install theirs after;  ours pass everything
+ * on to the hook they replaced.
  */
 void
 _PG_init(void)
 {
-	if (ProcessUtility_hook != NULL)
-		elog(FATAL, "a ProcessUtility hook is already installed.");
 	old_utility_hook = ProcessUtility_hook;
 	ProcessUtility_hook = utility_hook;
 
+	DefineCustomIntVariable("schema_triggers.max_relations",
+							"Maximum number of relations whose schema versions are tracked.",
+							NULL,
+							&max_tracked_relations,
+							10000,
+							100,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("schema_triggers.max_waiters",
+							"Maximum number of sessions which may wait for schema changes at once.",
+							NULL,
+							&max_waiters,
+							64,
+							1,
+							INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomStringVariable("schema_triggers.notify_channels",
+							   "Publishes schema events to NOTIFY channels, as a list of event=channel pairs.",
+							   "The event name * matches any event without its own entry.",
+							   &notify_channels,
+							   "",
+							   PGC_SUSET,
+							   GUC_LIST_INPUT,
+							   check_notify_channels,
+							   assign_notify_channels,
+							   NULL);
+
+	DefineCustomIntVariable("schema_triggers.max_nesting_depth",
+							"Sets the maximum nesting depth of statements run by event triggers.",
+							NULL,
+							&max_nesting_depth,
+							8,
+							0,
+							1000,
+							PGC_SUSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("schema_triggers.queue_mem",
+							"Sets the memory a statement's queued events may use before they are spilled to disk.",
+							NULL,
+							&queue_mem,
+							4096,
+							64,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("schema_triggers.lock_sample_interval",
+							"Sets how often a DDL statement's lock waits are sampled for ddl_statement_end.",
+							NULL,
+							&lock_sample_interval,
+							10,
+							1,
+							1000,
+							PGC_USERSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomStringVariable("schema_triggers.record_file",
+							   "Appends the events fired by statements to this file, for replay().",
+							   NULL,
+							   &record_file,
+							   "",
+							   PGC_SUSET,
+							   0,
+							   NULL,
+							   NULL,
+							   NULL);
+
+	DefineCustomBoolVariable("schema_triggers.trace",
+							 "Records a timeline of this session's event processing for dump_trace().",
+							 NULL,
+							 &trace_enabled,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("schema_triggers.trace_max_spans",
+							"Sets the maximum number of spans recorded for dump_trace().",
+							NULL,
+							&trace_max_spans,
+							10000,
+							100,
+							INT_MAX / 2,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	InitEventTriggers();
 	install_objacc_hook();
+	install_shmem_hook();
 }
 
 
 void
 _PG_fini(void)
 {
-	if (ProcessUtility_hook != utility_hook)
-		elog(FATAL, "hook conflict, our ProcessUtility hook has been removed.");
-	ProcessUtility_hook = old_utility_hook;
+	/*
+	 * A module loaded after us may have chained to our hook;  if so, it
+	 * still calls it, so leave it (and the hook it calls) in place.
+	 */
+	if (ProcessUtility_hook == utility_hook)
+		ProcessUtility_hook = old_utility_hook;
 
+	FiniEventTriggers();
 	remove_objacc_hook();
+	remove_shmem_hook();
 }
 
 
@@ -83,7 +209,15 @@ utility_hook(Node *parsetree,
 	DestReceiver *dest,
 	char *completionTag)
 {
-	/* Intercept the CREATE EVENT TRIGGER command. */
+	TRACE_SCHEMA_TRIGGERS_UTILITY_START(CreateCommandTag(parsetree));
+
+	/*
+	 * Intercept the CREATE EVENT TRIGGER command.  A trigger on one of our own
+	 * events is created here, and the previous hooks are not called for the
+	 * statement:  they would end up in CreateEventTrigger(), which rejects the
+	 * event name.  So a module loaded before us, such as pg_stat_statements,
+	 * doesn't see these statements.
+	 */
 	if (nodeTag(parsetree) == T_CreateEventTrigStmt)
 	{
 		CreateEventTrigStmt *stmt = (CreateEventTrigStmt *) parsetree;
@@ -91,27 +225,38 @@ utility_hook(Node *parsetree,
 
 		suppress = stmt_createEventTrigger_before(stmt);
 		if (suppress)
+		{
+			TRACE_SCHEMA_TRIGGERS_UTILITY_DONE(CreateCommandTag(parsetree));
 			return;
+		}
 	}
 
-	/* Pass all other commands through to the default implementation. */
+	/*
+	 * Pass all other commands through to the previous hook, if any, or the
+	 * default implementation, then fire the statement's events.  If either
+	 * fails, the events are discarded without being fired.
+	 */
 	if (context != PROCESS_UTILITY_SUBCOMMAND)
-		StartNewEvent();
+		StartNewEvent(parsetree, queryString);
 
 	PG_TRY();
 	{
-		standard_ProcessUtility(parsetree, queryString, context, params, dest, completionTag);
+		if (old_utility_hook)
+			old_utility_hook(parsetree, queryString, context, params, dest, completionTag);
+		else
+			standard_ProcessUtility(parsetree, queryString, context, params, dest, completionTag);
+		if (context != PROCESS_UTILITY_SUBCOMMAND)
+			EndEvent();
 	}
 	PG_CATCH();
 	{
 		if (context != PROCESS_UTILITY_SUBCOMMAND)
-			EndEvent();
+			AbortEvent();
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
 
-	if (context != PROCESS_UTILITY_SUBCOMMAND)
-		EndEvent();
+	TRACE_SCHEMA_TRIGGERS_UTILITY_DONE(CreateCommandTag(parsetree));
 }
 
 
@@ -128,12 +273,15 @@ struct event supported_events[] = {
 	{"column_alter"},
 	{"column_drop"},
 	{"relation_create"},
+	{"relation_create_complete"},
 	{"relation_alter"},
+	{"relation_rewrite"},
 	{"relation_drop"},
 	{"trigger_create"},
 	{"trigger_adjust"},
 	{"trigger_rename"},
 	{"trigger_drop"},
+	{"ddl_statement_end"},
 
 	/* end of list marker */
 	{NULL}
@@ -170,10 +318,20 @@ stmt_createEventTrigger_before(CreateEventTrigStmt *stmt)
 	}
 	if (!recognized)
 	{
-		elog(INFO, "pg_schema_triggers:  didn't recognize event name, ignoring.");
+		/* Our own script creates a table_rewrite trigger;  say nothing of it. */
+		if (!creating_extension)
+			elog(INFO, "pg_schema_triggers:  didn't recognize event name, ignoring.");
 		return 0;
 	}
 
+#if PG_VERSION_NUM < 90500
+	/* relation_rewrite is raised from the server's table_rewrite event. */
+	if (strcmp(stmt->eventname, "relation_rewrite") == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("the relation_rewrite event requires PostgreSQL 9.5 or later")));
+#endif
+
 	/* Check the trigger function's return type. */
     if (get_func_rettype(funcoid) != EVTTRIGGEROID)
         ereport(ERROR,
@@ -181,15 +339,11 @@ stmt_createEventTrigger_before(CreateEventTrigStmt *stmt)
                  errmsg("function \"%s\" must return type \"%s\"",
                         get_func_name(funcoid), format_type_be(EVTTRIGGEROID))));
 
-	/* None of our events support the WHEN clause, so ensure that it is empty. */
-	if (stmt->whenclause)
-		ereport(ERROR,
-				(errcode(ERRCODE_SYNTAX_ERROR),
-				 errmsg("event \"%s\" cannot have a WHEN clause",
-						stmt->eventname)));
-
-	/* Create the event trigger. */
-    CreateEventTriggerEx(stmt->eventname, stmt->trigname, funcoid);
+	/*
+	 * Create the event trigger.  Our events use the WHEN clause for
+	 * per-trigger options rather than command tags.
+	 */
+    CreateEventTriggerEx(stmt->eventname, stmt->trigname, funcoid, stmt->whenclause);
 
 	/* And skip the call to CreateEventTrigger(). */
 	return 1;
@@ -0,0 +1,343 @@
+/*
+ * Build a JSONB document describing the current event.
+ *
+ * The document is built directly from the EventInfo struct, walking its
+ * EventInfoDesc and the attributes of any captured catalog rows once.  Only
+ * fields which differ from their type's default (NULL, false, zero or
+ * InvalidOid) are included, which keeps documents for pg_class rows small.
+ * The document is built at most once per event and kept with the EventInfo,
+ * so that every trigger fired for the event shares it.
+ *
+ * JSONB is only available on PostgreSQL 9.4 and up.
+ *
+ * pg_schema_triggers/jsonb_funcs.c
+ */
+
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
+#if PG_VERSION_NUM >= 90400
+#include "utils/jsonb.h"
+#endif
+
+
+#include "jsonb_funcs.h"
+#include "trigger_funcs.h"
+
+
+#if PG_VERSION_NUM >= 90400
+
+
+static void push_key(JsonbParseState **state, const char *key);
+static void push_string(JsonbParseState **state, const char *key, const char *value);
+static void push_number(JsonbParseState **state, const char *key, int64 value);
+static void push_float4(JsonbParseState **state, const char *key, float4 value);
+static void push_float8(JsonbParseState **state, const char *key, float8 value);
+static void push_true(JsonbParseState **state, const char *key);
+static void push_tuple(JsonbParseState **state, const char *key, HeapTuple tuple);
+static Jsonb *build_event_jsonb(EventInfo *info);
+
+
+static void
+push_key(JsonbParseState **state, const char *key)
+{
+	JsonbValue v;
+
+	v.type = jbvString;
+	v.val.string.len = strlen(key);
+	v.val.string.val = (char *) key;
+	pushJsonbValue(state, WJB_KEY, &v);
+}
+
+
+static void
+push_string(JsonbParseState **state, const char *key, const char *value)
+{
+	JsonbValue v;
+
+	push_key(state, key);
+	v.type = jbvString;
+	v.val.string.len = strlen(value);
+	v.val.string.val = (char *) value;
+	pushJsonbValue(state, WJB_VALUE, &v);
+}
+
+
+/* Push a number, unless it is zero. */
+static void
+push_number(JsonbParseState **state, const char *key, int64 value)
+{
+	JsonbValue v;
+
+	if (value == 0)
+		return;
+	push_key(state, key);
+	v.type = jbvNumeric;
+	v.val.numeric = DatumGetNumeric(DirectFunctionCall1(int8_numeric,
+														Int64GetDatum(value)));
+	pushJsonbValue(state, WJB_VALUE, &v);
+}
+
+
+static void
+push_float4(JsonbParseState **state, const char *key, float4 value)
+{
+	JsonbValue v;
+
+	if (value == 0)
+		return;
+	push_key(state, key);
+	v.type = jbvNumeric;
+	v.val.numeric = DatumGetNumeric(DirectFunctionCall1(float4_numeric,
+														Float4GetDatum(value)));
+	pushJsonbValue(state, WJB_VALUE, &v);
+}
+
+
+static void
+push_float8(JsonbParseState **state, const char *key, float8 value)
+{
+	JsonbValue v;
+
+	if (value == 0)
+		return;
+	push_key(state, key);
+	v.type = jbvNumeric;
+	v.val.numeric = DatumGetNumeric(DirectFunctionCall1(float8_numeric,
+														Float8GetDatum(value)));
+	pushJsonbValue(state, WJB_VALUE, &v);
+}
+
+
+static void
+push_true(JsonbParseState **state, const char *key)
+{
+	JsonbValue v;
+
+	push_key(state, key);
+	v.type = jbvBool;
+	v.val.boolean = true;
+	pushJsonbValue(state, WJB_VALUE, &v);
+}
+
+
+/*
+ * Push a catalog row as an object of its non-default attributes.  Numbers and
+ * booleans are converted directly;  everything else goes through the type's
+ * output function.  A NULL key pushes the object as an array element.
+ */
+static void
+push_tuple(JsonbParseState **state, const char *key, HeapTuple tuple)
+{
+	TupleDesc tupdesc;
+	int i;
+
+	tupdesc = lookup_rowtype_tupdesc(HeapTupleHeaderGetTypeId(tuple->t_data),
+									 HeapTupleHeaderGetTypMod(tuple->t_data));
+
+	if (key != NULL)
+		push_key(state, key);
+	pushJsonbValue(state, WJB_BEGIN_OBJECT, NULL);
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+		const char *attname = NameStr(attr->attname);
+		Datum value;
+		bool isnull;
+
+		if (attr->attisdropped)
+			continue;
+		value = heap_getattr(tuple, i + 1, tupdesc, &isnull);
+		if (isnull)
+			continue;
+
+		switch (attr->atttypid)
+		{
+			case BOOLOID:
+				if (DatumGetBool(value))
+					push_true(state, attname);
+				break;
+			case INT2OID:
+				push_number(state, attname, DatumGetInt16(value));
+				break;
+			case INT4OID:
+				push_number(state, attname, DatumGetInt32(value));
+				break;
+			case OIDOID:
+			case REGPROCOID:
+				push_number(state, attname, DatumGetObjectId(value));
+				break;
+			case XIDOID:
+				push_number(state, attname, DatumGetTransactionId(value));
+				break;
+			case CHAROID:
+			{
+				char str[2];
+
+				str[0] = DatumGetChar(value);
+				str[1] = '\0';
+				if (str[0] != '\0')
+					push_string(state, attname, str);
+				break;
+			}
+			case NAMEOID:
+				push_string(state, attname, NameStr(*DatumGetName(value)));
+				break;
+			case FLOAT4OID:
+				push_float4(state, attname, DatumGetFloat4(value));
+				break;
+			default:
+			{
+				Oid typoutput;
+				bool typisvarlena;
+
+				getTypeOutputInfo(attr->atttypid, &typoutput, &typisvarlena);
+				push_string(state, attname, OidOutputFunctionCall(typoutput, value));
+				break;
+			}
+		}
+	}
+	pushJsonbValue(state, WJB_END_OBJECT, NULL);
+
+	ReleaseTupleDesc(tupdesc);
+}
+
+
+static Jsonb *
+build_event_jsonb(EventInfo *info)
+{
+	const EventInfoDesc *desc = info->desc;
+	JsonbParseState *state = NULL;
+	JsonbValue *result;
+	int i;
+
+	pushJsonbValue(&state, WJB_BEGIN_OBJECT, NULL);
+
+	/* The header fields common to all events. */
+	push_string(&state, "event", info->eventname);
+	push_number(&state, "relation", info->relation);
+	push_number(&state, "seqno", (int64) info->seqno);
+	push_number(&state, "xid", info->xid);
+	push_number(&state, "stmt_index", info->stmt_index);
+	if (info->children != NIL)
+	{
+		ListCell *lc;
+
+		push_key(&state, "children");
+		pushJsonbValue(&state, WJB_BEGIN_ARRAY, NULL);
+		foreach(lc, info->children)
+		{
+			JsonbValue v;
+
+			v.type = jbvNumeric;
+			v.val.numeric = DatumGetNumeric(DirectFunctionCall1(int8_numeric,
+																Int64GetDatum((int64) lfirst_oid(lc))));
+			pushJsonbValue(&state, WJB_ELEM, &v);
+		}
+		pushJsonbValue(&state, WJB_END_ARRAY, NULL);
+	}
+
+	/* The event's own fields. */
+	for (i = 0; i < desc->nfields; i++)
+	{
+		const EventFieldDesc *field = &desc->fields[i];
+		char *ptr = (char *) info + field->offset;
+
+		switch (field->type)
+		{
+			case EVENT_FIELD_OID:
+				push_number(&state, field->name, *(Oid *) ptr);
+				break;
+			case EVENT_FIELD_INT16:
+				push_number(&state, field->name, *(int16 *) ptr);
+				break;
+			case EVENT_FIELD_INT32:
+				push_number(&state, field->name, *(int32 *) ptr);
+				break;
+			case EVENT_FIELD_INT64:
+				push_number(&state, field->name, *(int64 *) ptr);
+				break;
+			case EVENT_FIELD_FLOAT4:
+				push_float4(&state, field->name, *(float4 *) ptr);
+				break;
+			case EVENT_FIELD_FLOAT8:
+				push_float8(&state, field->name, *(float8 *) ptr);
+				break;
+			case EVENT_FIELD_BOOL:
+				if (*(bool *) ptr)
+					push_true(&state, field->name);
+				break;
+			case EVENT_FIELD_ROW:
+			{
+				HeapTuple tuple = captured_row_tuple((CapturedRow *) ptr);
+
+				if (HeapTupleIsValid(tuple))
+					push_tuple(&state, field->name, tuple);
+				break;
+			}
+			case EVENT_FIELD_ROW_ARRAY:
+			{
+				CapturedRowArray *array = (CapturedRowArray *) ptr;
+				int j;
+
+				if (array->level == CAPTURE_OID)
+					break;
+				push_key(&state, field->name);
+				pushJsonbValue(&state, WJB_BEGIN_ARRAY, NULL);
+				for (j = 0; j < array->nrows; j++)
+					push_tuple(&state, NULL, captured_row_tuple(&array->rows[j]));
+				pushJsonbValue(&state, WJB_END_ARRAY, NULL);
+				break;
+			}
+		}
+	}
+
+	result = pushJsonbValue(&state, WJB_END_OBJECT, NULL);
+	return JsonbValueToJsonb(result);
+}
+
+
+#endif	/* PG_VERSION_NUM >= 90400 */
+
+
+PG_FUNCTION_INFO_V1(current_event_jsonb);
+Datum
+current_event_jsonb(PG_FUNCTION_ARGS)
+{
+#if PG_VERSION_NUM >= 90400
+	EventInfo *info;
+	Jsonb *jsonb;
+
+	/* Get the EventInfo struct, whatever the event. */
+	info = GetCurrentEvent(NULL);
+
+	/*
+	 * Build the document on first use, and keep a copy alongside the
+	 * EventInfo;  the caller always gets its own copy.
+	 */
+	if (info->jsonb == NULL)
+	{
+		jsonb = build_event_jsonb(info);
+		EnterEventMemoryContext();
+		info->jsonb = (struct varlena *) palloc(VARSIZE(jsonb));
+		memcpy(info->jsonb, jsonb, VARSIZE(jsonb));
+		LeaveEventMemoryContext();
+	}
+	else
+	{
+		jsonb = (Jsonb *) palloc(VARSIZE(info->jsonb));
+		memcpy(jsonb, info->jsonb, VARSIZE(info->jsonb));
+	}
+	PG_RETURN_JSONB(jsonb);
+#else
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("get_current_event_jsonb() requires PostgreSQL 9.4 or later")));
+	PG_RETURN_NULL();
+#endif
+}
@@ -0,0 +1,22 @@
+/*-------------------------------------------------------------------------
+ *
+ * jsonb_funcs.h
+ *    Declarations for building JSONB documents from events.
+ *
+ *
+ * pg_schema_triggers/jsonb_funcs.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_JSONB_FUNCS_H
+#define SCHEMA_TRIGGERS_JSONB_FUNCS_H
+
+
+#include "postgres.h"
+#include "fmgr.h"
+
+
+Datum current_event_jsonb(PG_FUNCTION_ARGS);
+
+
+#endif	/* SCHEMA_TRIGGERS_JSONB_FUNCS_H */
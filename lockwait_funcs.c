@@ -0,0 +1,146 @@
+/*
+ * Sampling of this backend's heavyweight lock waits, for telling how much of
+ * a DDL statement's time went to waiting for its locks (typically an
+ * AccessExclusiveLock queued behind long-running queries) rather than to the
+ * work itself.
+ *
+ * There is no hook around lock acquisition, so while any statement wants its
+ * waits measured, a timeout fires every schema_triggers.lock_sample_interval
+ * milliseconds and checks whether the backend is asleep on a lock.  Each
+ * sample which finds it waiting counts for a whole interval, so waits shorter
+ * than the interval may be missed or overcounted.  The relation and mode of
+ * the lock last waited for are kept too, to show what the statement was
+ * blocked on.
+ *
+ * pg_schema_triggers/lockwait_funcs.c
+ */
+
+
+#include "postgres.h"
+#include "miscadmin.h"
+#include "storage/lock.h"
+#include "storage/proc.h"
+#include "utils/timeout.h"
+#include "utils/timestamp.h"
+
+
+#include "lockwait_funcs.h"
+
+
+int lock_sample_interval = 10;
+
+/* Number of statements which want their waits sampled. */
+static int sampling = 0;
+
+static TimeoutId sample_timeout;
+static bool sample_timeout_registered = false;
+static int sample_interval = 0;		/* the interval in force, in ms */
+
+/* Updated by the timeout handler. */
+static volatile uint64 wait_samples = 0;
+static volatile uint64 wait_time = 0;
+static volatile Oid wait_relation = InvalidOid;
+static volatile int wait_mode = NoLock;
+
+
+static void sample_lock_wait(void);
+
+
+/*
+ * Start sampling, if no other statement has already.  Each call must be
+ * matched by one to lockwait_stop().
+ */
+void
+lockwait_start(void)
+{
+	if (sampling++ > 0)
+		return;
+
+	if (!sample_timeout_registered)
+	{
+		sample_timeout = RegisterTimeout(USER_TIMEOUT, sample_lock_wait);
+		sample_timeout_registered = true;
+	}
+	sample_interval = lock_sample_interval;
+#if PG_VERSION_NUM >= 150000
+	enable_timeout_every(sample_timeout,
+						 TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+													 sample_interval),
+						 sample_interval);
+#else
+	enable_timeout_after(sample_timeout, sample_interval);
+#endif
+}
+
+
+/* Stop sampling, once no statement wants it. */
+void
+lockwait_stop(void)
+{
+	Assert(sampling > 0);
+	if (--sampling > 0)
+		return;
+
+	disable_timeout(sample_timeout, false);
+}
+
+
+/* Stop sampling for every statement, such as when their contexts are lost. */
+void
+lockwait_reset(void)
+{
+	if (sampling == 0)
+		return;
+
+	sampling = 1;
+	lockwait_stop();
+}
+
+
+/* Copy the backend's lock wait counters. */
+void
+lockwait_read(LockWaitCounters *counters)
+{
+	counters->samples = wait_samples;
+	counters->wait_time = wait_time;
+	counters->relation = wait_relation;
+	counters->mode = wait_mode;
+}
+
+
+/*
+ * The timeout handler, run from the SIGALRM handler:  note whether the
+ * backend is waiting for a lock.  The lock being waited for stays put until
+ * the backend wakes up.
+ *
+ * Servers before 15 have no repeating timeouts, and nothing else of ours runs
+ * while the backend sleeps on a lock, so there the handler sets the next
+ * sample going itself.  handle_sig_alarm() allows for that:  it looks at the
+ * list of active timeouts afresh after each handler, and schedules the next
+ * alarm once they have all run.
+ */
+static void
+sample_lock_wait(void)
+{
+	volatile PGPROC *proc = MyProc;
+	LOCK *lock;
+
+	if (sampling == 0 || proc == NULL)
+		return;
+
+	lock = proc->waitLock;
+	if (lock != NULL)
+	{
+		wait_samples++;
+		wait_time += sample_interval;
+		if (lock->tag.locktag_type == LOCKTAG_RELATION)
+			wait_relation = (Oid) lock->tag.locktag_field2;
+		else
+			wait_relation = InvalidOid;
+		wait_mode = proc->waitLockMode;
+	}
+
+#if PG_VERSION_NUM < 150000
+	enable_timeout_after(sample_timeout, sample_interval);
+#endif
+}
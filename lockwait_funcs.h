@@ -0,0 +1,36 @@
+/*-------------------------------------------------------------------------
+ *
+ * lockwait_funcs.h
+ *    Declarations for sampling this backend's heavyweight lock waits.
+ *
+ *
+ * pg_schema_triggers/lockwait_funcs.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_LOCKWAIT_FUNCS_H
+#define SCHEMA_TRIGGERS_LOCKWAIT_FUNCS_H
+
+
+#include "postgres.h"
+
+
+/* Cumulative lock waits of this backend, while sampling was on. */
+typedef struct LockWaitCounters {
+	uint64 samples;				/* samples which found the backend waiting */
+	uint64 wait_time;			/* estimated time spent waiting, in ms */
+	Oid relation;				/* relation last waited for, or InvalidOid */
+	int mode;					/* lock mode last waited for, or NoLock */
+} LockWaitCounters;
+
+
+extern int lock_sample_interval;
+
+
+void lockwait_start(void);
+void lockwait_stop(void);
+void lockwait_reset(void);
+void lockwait_read(LockWaitCounters *counters);
+
+
+#endif	/* SCHEMA_TRIGGERS_LOCKWAIT_FUNCS_H */
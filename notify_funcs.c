@@ -0,0 +1,338 @@
+/*
+ * Built-in publishing of schema events with NOTIFY.
+ *
+ * When schema_triggers.notify_channels maps an event name to a channel, the
+ * events of each statement are published to that channel without running any
+ * event trigger.  The events are deduplicated per (event, relation) and packed
+ * into as few NOTIFY payloads as the payload size limit allows.  Each payload
+ * is a JSON object mapping event names to arrays of relation Oids:
+ *
+ *     {"column_add":[16384,16390],"relation_alter":[16384]}
+ *
+ * pg_schema_triggers/notify_funcs.c
+ */
+
+
+#include "postgres.h"
+#include "commands/async.h"
+#include "lib/stringinfo.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+
+
+#include "notify_funcs.h"
+#include "trigger_funcs.h"
+
+
+/* One deduplicated event to be published. */
+typedef struct NotifyItem {
+	const char *channel;
+	const char *eventname;
+	Oid relation;
+} NotifyItem;
+
+
+/* One entry of schema_triggers.notify_channels. */
+typedef struct NotifyChannel {
+	char event[NAMEDATALEN];	/* "*" for any event without its own entry */
+	char channel[NAMEDATALEN];
+} NotifyChannel;
+
+/*
+ * schema_triggers.notify_channels, parsed once by check_notify_channels() as
+ * the setting's "extra" data, so a single malloc'd chunk.
+ */
+typedef struct NotifyMapping {
+	int nchannels;
+	NotifyChannel channels[FLEXIBLE_ARRAY_MEMBER];
+} NotifyMapping;
+
+#define NotifyMappingSize(nchannels) \
+	(offsetof(NotifyMapping, channels) + (nchannels) * sizeof(NotifyChannel))
+
+/* The events of a statement which have a channel. */
+struct NotifyQueue {
+	NotifyMapping *mapping;		/* copy of the setting when it began */
+	NotifyItem *items;
+	int nitems;
+	int maxitems;
+};
+
+
+char *notify_channels = NULL;
+
+/* The current setting's NotifyMapping, or NULL if no channels are set. */
+static NotifyMapping *notify_mapping = NULL;
+
+
+static List *parse_notify_channels(const char *value);
+static const char *channel_for_event(NotifyMapping *mapping, const char *eventname);
+static int notify_item_cmp(const void *a, const void *b);
+static void send_payload(const char *channel, StringInfo payload);
+
+
+/*
+ * Parse a "event=channel, ..." list into a List of two-element Lists of
+ * strings.  The event name "*" matches any event without its own entry.
+ * Returns NIL, with GUC_check_errdetail() set, if the value is malformed.
+ */
+static List *
+parse_notify_channels(const char *value)
+{
+	char *rawstring = pstrdup(value);
+	List *elemlist;
+	List *mapping = NIL;
+	ListCell *lc;
+
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		GUC_check_errdetail("List syntax is invalid.");
+		return NIL;
+	}
+
+	foreach(lc, elemlist)
+	{
+		char *elem = (char *) lfirst(lc);
+		char *sep = strchr(elem, '=');
+
+		if (sep == NULL || sep == elem || sep[1] == '\0')
+		{
+			GUC_check_errdetail("Entry \"%s\" is not of the form event=channel.", elem);
+			return NIL;
+		}
+		*sep = '\0';
+		if (strlen(sep + 1) >= NAMEDATALEN)
+		{
+			GUC_check_errdetail("Channel name \"%s\" is too long.", sep + 1);
+			return NIL;
+		}
+		mapping = lappend(mapping, list_make2(elem, sep + 1));
+	}
+	list_free(elemlist);
+	return mapping;
+}
+
+
+/*
+ * Check a new value of schema_triggers.notify_channels, and parse it into a
+ * NotifyMapping for assign_notify_channels().  An empty value has none.
+ */
+bool
+check_notify_channels(char **newval, void **extra, GucSource source)
+{
+	List *entries;
+	NotifyMapping *mapping;
+	ListCell *lc;
+	int i = 0;
+
+	if (*newval == NULL || **newval == '\0')
+		return true;
+	entries = parse_notify_channels(*newval);
+	if (entries == NIL)
+		return false;
+
+	mapping = (NotifyMapping *) malloc(NotifyMappingSize(list_length(entries)));
+	if (mapping == NULL)
+		return false;
+	mapping->nchannels = list_length(entries);
+	foreach(lc, entries)
+	{
+		List *entry = (List *) lfirst(lc);
+
+		strlcpy(mapping->channels[i].event, (const char *) linitial(entry), NAMEDATALEN);
+		strlcpy(mapping->channels[i].channel, (const char *) lsecond(entry), NAMEDATALEN);
+		i++;
+	}
+	*extra = mapping;
+	return true;
+}
+
+
+void
+assign_notify_channels(const char *newval, void *extra)
+{
+	notify_mapping = (NotifyMapping *) extra;
+}
+
+
+static const char *
+channel_for_event(NotifyMapping *mapping, const char *eventname)
+{
+	const char *fallback = NULL;
+	int i;
+
+	for (i = 0; i < mapping->nchannels; i++)
+	{
+		NotifyChannel *entry = &mapping->channels[i];
+
+		if (strcmp(entry->event, eventname) == 0)
+			return entry->channel;
+		if (strcmp(entry->event, "*") == 0 && fallback == NULL)
+			fallback = entry->channel;
+	}
+	return fallback;
+}
+
+
+static int
+notify_item_cmp(const void *a, const void *b)
+{
+	const NotifyItem *ia = (const NotifyItem *) a;
+	const NotifyItem *ib = (const NotifyItem *) b;
+	int cmp;
+
+	cmp = strcmp(ia->channel, ib->channel);
+	if (cmp != 0)
+		return cmp;
+	cmp = strcmp(ia->eventname, ib->eventname);
+	if (cmp != 0)
+		return cmp;
+	if (ia->relation != ib->relation)
+		return (ia->relation < ib->relation) ? -1 : 1;
+	return 0;
+}
+
+
+static void
+send_payload(const char *channel, StringInfo payload)
+{
+	appendStringInfoString(payload, "]}");
+	Async_Notify(channel, payload->data);
+	resetStringInfo(payload);
+}
+
+
+/*
+ * Create a queue for the events of a statement, in the current memory
+ * context.  Returns NULL if no channels are configured.  The queue keeps its
+ * own copy of the parsed setting, which a trigger could change before the
+ * statement ends.
+ */
+NotifyQueue *
+notify_queue_create(void)
+{
+	NotifyQueue *queue;
+	Size size;
+
+	if (notify_mapping == NULL)
+		return NULL;
+
+	queue = (NotifyQueue *) palloc(sizeof(NotifyQueue));
+	size = NotifyMappingSize(notify_mapping->nchannels);
+	queue->mapping = (NotifyMapping *) palloc(size);
+	memcpy(queue->mapping, notify_mapping, size);
+	queue->nitems = 0;
+	queue->maxitems = 16;
+	queue->items = (NotifyItem *) palloc(queue->maxitems * sizeof(NotifyItem));
+	return queue;
+}
+
+
+/*
+ * Return true if events of the given name have a channel.
+ */
+bool
+notify_queue_wants(NotifyQueue *queue, const char *eventname)
+{
+	return queue != NULL && channel_for_event(queue->mapping, eventname) != NULL;
+}
+
+
+/*
+ * Remember an event for publishing, if it has a channel.  Only the event's
+ * name and relation are kept, so the EventInfo itself need not stay around.
+ */
+void
+notify_queue_add(NotifyQueue *queue, EventInfo *event)
+{
+	notify_queue_add_relation(queue, event->desc->eventname, event->relation);
+}
+
+
+/*
+ * Remember an event on the given relation which isn't raised by itself, such
+ * as one collapsed into the same event on an inheritance parent.  The event
+ * name must be a constant string.
+ */
+void
+notify_queue_add_relation(NotifyQueue *queue, const char *eventname, Oid relation)
+{
+	const char *channel;
+
+	if (queue == NULL)
+		return;
+	channel = channel_for_event(queue->mapping, eventname);
+	if (channel == NULL)
+		return;
+
+	if (queue->nitems == queue->maxitems)
+	{
+		queue->maxitems *= 2;
+		queue->items = (NotifyItem *) repalloc(queue->items,
+											   queue->maxitems * sizeof(NotifyItem));
+	}
+	queue->items[queue->nitems].channel = channel;
+	queue->items[queue->nitems].eventname = eventname;
+	queue->items[queue->nitems].relation = relation;
+	queue->nitems++;
+}
+
+
+/*
+ * Publish the events of a statement to their configured channels.
+ */
+void
+publish_events(NotifyQueue *queue)
+{
+	NotifyItem *items;
+	int nitems;
+	StringInfoData payload;
+	int i;
+
+	if (queue == NULL || queue->nitems == 0)
+		return;
+	items = queue->items;
+	nitems = queue->nitems;
+
+	/* Sort the events, so that duplicates can be skipped. */
+	qsort(items, nitems, sizeof(NotifyItem), notify_item_cmp);
+
+	/*
+	 * Build the payloads.  A new payload is started whenever the channel
+	 * changes, or when the next item would push the payload over the limit
+	 * (leaving room for the closing brackets).
+	 */
+	initStringInfo(&payload);
+	for (i = 0; i < nitems; i++)
+	{
+		NotifyItem *item = &items[i];
+		NotifyItem *prev = (i > 0) ? &items[i - 1] : NULL;
+		char relstr[16];
+		bool new_event;
+
+		if (prev != NULL && notify_item_cmp(prev, item) == 0)
+			continue;
+		if (prev != NULL && strcmp(prev->channel, item->channel) != 0)
+			send_payload(prev->channel, &payload);
+		snprintf(relstr, sizeof(relstr), "%u", item->relation);
+
+		new_event = (payload.len == 0 || strcmp(prev->eventname, item->eventname) != 0);
+		if (payload.len > 0 &&
+			payload.len + strlen(item->eventname) + strlen(relstr) + 8 >= NOTIFY_PAYLOAD_MAX_LENGTH)
+		{
+			send_payload(prev->channel, &payload);
+			new_event = true;
+		}
+
+		if (payload.len == 0)
+			appendStringInfo(&payload, "{\"%s\":[%s", item->eventname, relstr);
+		else if (new_event)
+			appendStringInfo(&payload, "],\"%s\":[%s", item->eventname, relstr);
+		else
+			appendStringInfo(&payload, ",%s", relstr);
+	}
+	if (payload.len > 0)
+		send_payload(items[nitems - 1].channel, &payload);
+
+	pfree(payload.data);
+}
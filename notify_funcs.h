@@ -0,0 +1,37 @@
+/*-------------------------------------------------------------------------
+ *
+ * notify_funcs.h
+ *    Declarations for publishing schema events with NOTIFY.
+ *
+ *
+ * pg_schema_triggers/notify_funcs.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_NOTIFY_FUNCS_H
+#define SCHEMA_TRIGGERS_NOTIFY_FUNCS_H
+
+
+#include "postgres.h"
+#include "utils/guc.h"
+
+
+#include "trigger_funcs.h"
+
+
+typedef struct NotifyQueue NotifyQueue;
+
+
+extern char *notify_channels;
+
+
+bool check_notify_channels(char **newval, void **extra, GucSource source);
+void assign_notify_channels(const char *newval, void *extra);
+NotifyQueue *notify_queue_create(void);
+bool notify_queue_wants(NotifyQueue *queue, const char *eventname);
+void notify_queue_add(NotifyQueue *queue, EventInfo *event);
+void notify_queue_add_relation(NotifyQueue *queue, const char *eventname, Oid relation);
+void publish_events(NotifyQueue *queue);
+
+
+#endif	/* SCHEMA_TRIGGERS_NOTIFY_FUNCS_H */
@@ -0,0 +1,47 @@
+/*-------------------------------------------------------------------------
+ *
+ * probes.h
+ *    Static trace probes, which compile to nothing unless the extension is
+ *    built with "make enable_dtrace=yes".
+ *
+ *
+ * pg_schema_triggers/probes.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_PROBES_H
+#define SCHEMA_TRIGGERS_PROBES_H
+
+
+#ifdef SCHEMA_TRIGGERS_DTRACE
+
+/* Generated from probes.d by the Makefile. */
+#include "probes_dtrace.h"
+
+#else
+
+#define TRACE_SCHEMA_TRIGGERS_UTILITY_START(INT1) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_UTILITY_START_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_UTILITY_DONE(INT1) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_UTILITY_DONE_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_OBJECTACCESS(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_OBJECTACCESS_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_CATALOG_FETCH_START(INT1, INT2) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_CATALOG_FETCH_START_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_CATALOG_FETCH_DONE(INT1, INT2, INT3) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_CATALOG_FETCH_DONE_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_EVENT_ENQUEUE(INT1, INT2, INT3, INT4) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_EVENT_ENQUEUE_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_EVENT_FIRE_START(INT1, INT2, INT3) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_EVENT_FIRE_START_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_EVENT_FIRE_DONE(INT1, INT2) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_EVENT_FIRE_DONE_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_TRIGGER_START(INT1, INT2, INT3) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_TRIGGER_START_ENABLED() (0)
+#define TRACE_SCHEMA_TRIGGERS_TRIGGER_DONE(INT1, INT2, INT3) do {} while (0)
+#define TRACE_SCHEMA_TRIGGERS_TRIGGER_DONE_ENABLED() (0)
+
+#endif	/* SCHEMA_TRIGGERS_DTRACE */
+
+
+#endif	/* SCHEMA_TRIGGERS_PROBES_H */
@@ -0,0 +1,405 @@
+/*
+ * The queue of events raised by a statement, which are fired when the
+ * statement ends.
+ *
+ * Events are kept in memory until they use more than schema_triggers.queue_mem
+ * kilobytes;  then every event in memory is written to a temporary file and
+ * freed.  Reading the queue back returns the spilled events first, one at a
+ * time, followed by those still in memory, so the events come back in the
+ * order they were raised while memory use stays bounded however many objects
+ * a statement touches.
+ *
+ * pg_schema_triggers/queue_funcs.c
+ */
+
+
+#include "postgres.h"
+#include "access/htup_details.h"
+#include "storage/buffile.h"
+#include "utils/memutils.h"
+
+
+#include "queue_funcs.h"
+#include "trigger_funcs.h"
+
+
+struct EventQueue {
+	MemoryContext mcontext;			/* the context the events live in */
+	dlist_head events;				/* events in memory, after any spilled */
+	Size mem_used;					/* bytes used by the events in memory */
+	BufFile *file;					/* the spilled events, or NULL */
+	long nspilled;					/* number of events in the file */
+	long nread;						/* number of spilled events read back */
+	dlist_node *next;				/* next in-memory event to read back */
+	MemoryContext read_mcontext;	/* holds the last spilled event read back */
+	EventInfo *last_read;
+};
+
+
+int queue_mem = 4096;
+
+
+static void free_event(EventInfo *info);
+static void spill_events(EventQueue *queue);
+static void write_event(BufFile *file, EventInfo *info);
+static EventInfo *read_event(BufFile *file);
+static void write_row(CapturedRow *row, EventIOFunc write, void *arg);
+static void read_row(CapturedRow *row, EventIOFunc read, void *arg);
+static void write_bytes(void *file, void *ptr, size_t size);
+static void read_bytes(void *file, void *ptr, size_t size);
+
+
+/*
+ * Create an empty queue.  Events appended to the queue must be allocated in
+ * the current memory context.
+ */
+EventQueue *
+event_queue_create(void)
+{
+	EventQueue *queue;
+
+	queue = (EventQueue *) palloc0(sizeof(EventQueue));
+	queue->mcontext = CurrentMemoryContext;
+	dlist_init(&queue->events);
+	return queue;
+}
+
+
+/*
+ * Append an event to the queue.  The queue takes ownership of the event,
+ * which may be freed at once if the queue spills to disk.
+ */
+void
+event_queue_append(EventQueue *queue, EventInfo *info)
+{
+	Assert(info->jsonb == NULL);
+
+	dlist_push_tail(&queue->events, &info->event_list_node);
+	queue->mem_used += event_size(info);
+	if (queue->mem_used > (Size) queue_mem * 1024L)
+		spill_events(queue);
+}
+
+
+/*
+ * Prepare to read the events back from the start.  No more events may be
+ * appended afterwards.
+ */
+void
+event_queue_rewind(EventQueue *queue)
+{
+	if (queue->file != NULL && BufFileSeek(queue->file, 0, 0L, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind event queue temporary file: %m")));
+	queue->nread = 0;
+	queue->next = dlist_is_empty(&queue->events) ? NULL : dlist_head_node(&queue->events);
+}
+
+
+/*
+ * Return the next event, or NULL if there are no more.  An event read back
+ * from disk is only valid until the next call.
+ */
+EventInfo *
+event_queue_next(EventQueue *queue)
+{
+	EventInfo *info;
+
+	/* Free the previous spilled event, including any JSONB built for it. */
+	if (queue->last_read != NULL)
+	{
+		if (queue->last_read->jsonb != NULL)
+			pfree(queue->last_read->jsonb);
+		MemoryContextReset(queue->read_mcontext);
+		queue->last_read = NULL;
+	}
+
+	/* The spilled events come first. */
+	if (queue->nread < queue->nspilled)
+	{
+		MemoryContext old_mcontext;
+
+		old_mcontext = MemoryContextSwitchTo(queue->read_mcontext);
+		info = read_event(queue->file);
+		MemoryContextSwitchTo(old_mcontext);
+		queue->nread++;
+		queue->last_read = info;
+		return info;
+	}
+
+	/* Then those still in memory. */
+	if (queue->next == NULL)
+		return NULL;
+	info = dlist_container(EventInfo, event_list_node, queue->next);
+	queue->next = dlist_has_next(&queue->events, queue->next) ?
+		dlist_next_node(&queue->events, queue->next) : NULL;
+	return info;
+}
+
+
+/*
+ * Release the queue's temporary file.  The events themselves are freed along
+ * with their memory context.
+ */
+void
+event_queue_free(EventQueue *queue)
+{
+	if (queue->file != NULL)
+		BufFileClose(queue->file);
+	queue->file = NULL;
+}
+
+
+/*
+ * The memory used by an event, not counting allocator overhead.
+ */
+Size
+event_size(EventInfo *info)
+{
+	const EventInfoDesc *desc = info->desc;
+	Size size = desc->struct_size;
+	int i;
+	int j;
+
+	for (i = 0; i < desc->nfields; i++)
+	{
+		const EventFieldDesc *field = &desc->fields[i];
+		char *ptr = (char *) info + field->offset;
+
+		if (field->type == EVENT_FIELD_ROW)
+		{
+			CapturedRow *row = (CapturedRow *) ptr;
+
+			if (row->level == CAPTURE_FULL)
+				size += HEAPTUPLESIZE + row->tuple->t_len;
+		}
+		else if (field->type == EVENT_FIELD_ROW_ARRAY)
+		{
+			CapturedRowArray *array = (CapturedRowArray *) ptr;
+
+			size += array->nrows * sizeof(CapturedRow);
+			for (j = 0; j < array->nrows; j++)
+				if (array->rows[j].level == CAPTURE_FULL)
+					size += HEAPTUPLESIZE + array->rows[j].tuple->t_len;
+		}
+	}
+	return size;
+}
+
+
+static void
+free_event(EventInfo *info)
+{
+	const EventInfoDesc *desc = info->desc;
+	int i;
+	int j;
+
+	for (i = 0; i < desc->nfields; i++)
+	{
+		const EventFieldDesc *field = &desc->fields[i];
+		char *ptr = (char *) info + field->offset;
+
+		if (field->type == EVENT_FIELD_ROW)
+		{
+			CapturedRow *row = (CapturedRow *) ptr;
+
+			if (row->level == CAPTURE_FULL)
+				heap_freetuple(row->tuple);
+		}
+		else if (field->type == EVENT_FIELD_ROW_ARRAY)
+		{
+			CapturedRowArray *array = (CapturedRowArray *) ptr;
+
+			for (j = 0; j < array->nrows; j++)
+				if (array->rows[j].level == CAPTURE_FULL)
+					heap_freetuple(array->rows[j].tuple);
+			if (array->rows != NULL)
+				pfree(array->rows);
+		}
+	}
+	pfree(info);
+}
+
+
+/*
+ * Write every event in memory to the temporary file, and free them.
+ */
+static void
+spill_events(EventQueue *queue)
+{
+	dlist_mutable_iter iter;
+
+	/* Deferred captures must be complete before their events leave memory. */
+	ResolveEventCaptures(InvalidOid, 0);
+
+	if (queue->file == NULL)
+	{
+		MemoryContext old_mcontext;
+
+		old_mcontext = MemoryContextSwitchTo(queue->mcontext);
+		queue->file = BufFileCreateTemp(false);
+		queue->read_mcontext = AllocSetContextCreate(queue->mcontext,
+								 "event queue read context",
+								 ALLOCSET_DEFAULT_MINSIZE,
+								 ALLOCSET_DEFAULT_INITSIZE,
+								 ALLOCSET_DEFAULT_MAXSIZE);
+		MemoryContextSwitchTo(old_mcontext);
+	}
+
+	dlist_foreach_modify(iter, &queue->events)
+	{
+		EventInfo *info = dlist_container(EventInfo, event_list_node, iter.cur);
+
+		dlist_delete(iter.cur);
+		write_event(queue->file, info);
+		free_event(info);
+		queue->nspilled++;
+	}
+	queue->mem_used = 0;
+}
+
+
+/*
+ * Write an event to the file, preceded by the pointer to its EventInfoDesc;
+ * the file never outlives this backend, so the pointer is still valid when
+ * the event is read back.
+ */
+static void
+write_event(BufFile *file, EventInfo *info)
+{
+	write_bytes(file, &info->desc, sizeof(info->desc));
+	event_write(info, write_bytes, file);
+}
+
+
+/*
+ * Read an event written by write_event() into the current memory context.
+ */
+static EventInfo *
+read_event(BufFile *file)
+{
+	const EventInfoDesc *desc;
+
+	read_bytes(file, &desc, sizeof(desc));
+	return event_read(desc, read_bytes, file);
+}
+
+
+/*
+ * Write an event's struct as it is, followed by the contents of any arrays of
+ * catalog rows, and any full catalog rows.  The bytes are passed to 'write'.
+ */
+void
+event_write(EventInfo *info, EventIOFunc write, void *arg)
+{
+	const EventInfoDesc *desc = info->desc;
+	int i;
+	int j;
+
+	write(arg, info, desc->struct_size);
+	for (i = 0; i < desc->nfields; i++)
+	{
+		const EventFieldDesc *field = &desc->fields[i];
+		char *ptr = (char *) info + field->offset;
+
+		if (field->type == EVENT_FIELD_ROW)
+			write_row((CapturedRow *) ptr, write, arg);
+		else if (field->type == EVENT_FIELD_ROW_ARRAY)
+		{
+			CapturedRowArray *array = (CapturedRowArray *) ptr;
+
+			if (array->nrows > 0)
+				write(arg, array->rows, array->nrows * sizeof(CapturedRow));
+			for (j = 0; j < array->nrows; j++)
+				write_row(&array->rows[j], write, arg);
+		}
+	}
+}
+
+
+/*
+ * Read an event written by event_write() into the current memory context,
+ * getting the bytes from 'read'.  The event's pointers are fixed up, except
+ * that it has no children.
+ */
+EventInfo *
+event_read(const EventInfoDesc *desc, EventIOFunc read, void *arg)
+{
+	EventInfo *info;
+	int i;
+	int j;
+
+	info = (EventInfo *) palloc(desc->struct_size);
+	read(arg, info, desc->struct_size);
+	info->desc = desc;
+	info->children = NIL;
+	info->jsonb = NULL;
+	for (i = 0; i < desc->nfields; i++)
+	{
+		const EventFieldDesc *field = &desc->fields[i];
+		char *ptr = (char *) info + field->offset;
+
+		if (field->type == EVENT_FIELD_ROW)
+			read_row((CapturedRow *) ptr, read, arg);
+		else if (field->type == EVENT_FIELD_ROW_ARRAY)
+		{
+			CapturedRowArray *array = (CapturedRowArray *) ptr;
+
+			if (array->nrows == 0)
+				continue;
+			array->rows = (CapturedRow *) palloc(array->nrows * sizeof(CapturedRow));
+			read(arg, array->rows, array->nrows * sizeof(CapturedRow));
+			for (j = 0; j < array->nrows; j++)
+				read_row(&array->rows[j], read, arg);
+		}
+	}
+	return info;
+}
+
+
+/* Write a catalog row's tuple, if it has one. */
+static void
+write_row(CapturedRow *row, EventIOFunc write, void *arg)
+{
+	if (row->level != CAPTURE_FULL)
+		return;
+	write(arg, row->tuple, sizeof(HeapTupleData));
+	write(arg, row->tuple->t_data, row->tuple->t_len);
+}
+
+
+/* Read a catalog row's tuple written by write_row(), if it has one. */
+static void
+read_row(CapturedRow *row, EventIOFunc read, void *arg)
+{
+	HeapTupleData header;
+
+	if (row->level != CAPTURE_FULL)
+		return;
+	read(arg, &header, sizeof(HeapTupleData));
+	row->tuple = (HeapTuple) palloc(HEAPTUPLESIZE + header.t_len);
+	memcpy(row->tuple, &header, sizeof(HeapTupleData));
+	row->tuple->t_data = (HeapTupleHeader) ((char *) row->tuple + HEAPTUPLESIZE);
+	read(arg, row->tuple->t_data, row->tuple->t_len);
+}
+
+
+static void
+write_bytes(void *file, void *ptr, size_t size)
+{
+	if (BufFileWrite((BufFile *) file, ptr, size) != size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to event queue temporary file: %m")));
+}
+
+
+static void
+read_bytes(void *file, void *ptr, size_t size)
+{
+	if (BufFileRead((BufFile *) file, ptr, size) != size)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from event queue temporary file: %m")));
+}
@@ -0,0 +1,40 @@
+/*-------------------------------------------------------------------------
+ *
+ * queue_funcs.h
+ *    Declarations for the per-statement event queue.
+ *
+ *
+ * pg_schema_triggers/queue_funcs.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_QUEUE_FUNCS_H
+#define SCHEMA_TRIGGERS_QUEUE_FUNCS_H
+
+
+#include "postgres.h"
+
+
+#include "trigger_funcs.h"
+
+
+typedef struct EventQueue EventQueue;
+
+/* Writes or reads 'size' bytes of an event for event_write() or event_read(). */
+typedef void (*EventIOFunc) (void *arg, void *ptr, size_t size);
+
+
+extern int queue_mem;
+
+
+EventQueue *event_queue_create(void);
+void event_queue_append(EventQueue *queue, EventInfo *info);
+void event_queue_rewind(EventQueue *queue);
+EventInfo *event_queue_next(EventQueue *queue);
+void event_queue_free(EventQueue *queue);
+Size event_size(EventInfo *info);
+void event_write(EventInfo *info, EventIOFunc write, void *arg);
+EventInfo *event_read(const EventInfoDesc *desc, EventIOFunc read, void *arg);
+
+
+#endif	/* SCHEMA_TRIGGERS_QUEUE_FUNCS_H */
@@ -0,0 +1,397 @@
+/*
+ * Recording the events fired by statements to a file, and replaying them
+ * later through the event triggers defined at that time, so that trigger
+ * functions can be timed and profiled against real event streams without
+ * running the DDL again.
+ *
+ * While schema_triggers.record_file is set, every event a statement fires is
+ * appended to that file, captured in full whatever its triggers ask for.
+ * Each event is written as one record:  a RecordHeader, then the event name,
+ * the command tag and query of its statement, the event itself as written by
+ * event_write(), and the relations collapsed into it.  Each record is
+ * written with a single write() to a file opened for appending, so sessions
+ * may record to the same file at once.
+ *
+ * The catalog rows are kept in their on-disk format, so a file can only be
+ * replayed by a server of the same major version as the one that recorded it.
+ *
+ * pg_schema_triggers/record_funcs.c
+ */
+
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "lib/stringinfo.h"
+#include "storage/fd.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+
+#include "events.h"
+#include "queue_funcs.h"
+#include "record_funcs.h"
+#include "trigger_funcs.h"
+
+
+/* Precedes each event in the file. */
+typedef struct RecordHeader {
+	uint32 magic;				/* RECORD_MAGIC */
+	uint32 server_version;		/* PG_VERSION_NUM of the recording server */
+	uint32 size;				/* bytes following the header */
+} RecordHeader;
+
+/* Changes whenever the format of a record does. */
+#define RECORD_MAGIC 0x53545231
+
+
+/* The timings of one trigger, gathered while replaying events. */
+typedef struct ReplayTriggerStats {
+	Oid trigoid;
+	char *trigname;
+	char *eventname;
+	int64 calls;
+	double total_time;
+	double max_time;
+} ReplayTriggerStats;
+
+typedef struct ReplayState {
+	MemoryContext mcontext;		/* holds the ReplayTriggerStats */
+	List *triggers;				/* ReplayTriggerStats, in order of first call */
+} ReplayState;
+
+
+char *record_file = NULL;
+
+
+static void append_bytes(void *buf, void *ptr, size_t size);
+static bool read_record(FILE *file, const char *filename, StringInfo buf);
+static void read_bytes(void *buf, void *ptr, size_t size);
+static char *read_string(StringInfo buf);
+static void replay_timing(Oid trigoid, const char *trigname, const char *eventname,
+						  double elapsed, void *arg);
+
+
+/* Return true if events are being recorded. */
+bool
+record_enabled(void)
+{
+	return record_file != NULL && record_file[0] != '\0';
+}
+
+
+/*
+ * Open schema_triggers.record_file for appending the events of a statement,
+ * creating it if need be.  Returns -1 if events are not being recorded.
+ */
+int
+record_open(void)
+{
+	int fd;
+
+	if (!record_enabled())
+		return -1;
+
+	fd = OpenTransientFile(record_file, O_WRONLY | O_APPEND | O_CREAT | PG_BINARY,
+						   S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open event record file \"%s\": %m", record_file)));
+	return fd;
+}
+
+
+/*
+ * Append an event, raised by the given command, to the file opened by
+ * record_open().
+ */
+void
+record_event(int fd, const EventCommand *command, EventInfo *info)
+{
+	StringInfoData buf;
+	RecordHeader header;
+	int32 nchildren = list_length(info->children);
+	char has_query = (command->query != NULL);
+	ListCell *lc;
+
+	initStringInfo(&buf);
+	header.magic = RECORD_MAGIC;
+	header.server_version = PG_VERSION_NUM;
+	header.size = 0;
+	appendBinaryStringInfo(&buf, (char *) &header, sizeof(header));
+
+	appendBinaryStringInfo(&buf, info->eventname, strlen(info->eventname) + 1);
+	appendBinaryStringInfo(&buf, command->tag, strlen(command->tag) + 1);
+	appendBinaryStringInfo(&buf, &has_query, sizeof(has_query));
+	if (has_query)
+		appendBinaryStringInfo(&buf, command->query, strlen(command->query) + 1);
+	event_write(info, append_bytes, &buf);
+	appendBinaryStringInfo(&buf, (char *) &nchildren, sizeof(nchildren));
+	foreach(lc, info->children)
+	{
+		Oid child = lfirst_oid(lc);
+
+		appendBinaryStringInfo(&buf, (char *) &child, sizeof(child));
+	}
+
+	header.size = buf.len - sizeof(header);
+	memcpy(buf.data, &header, sizeof(header));
+	if (write(fd, buf.data, buf.len) != buf.len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to event record file \"%s\": %m", record_file)));
+	pfree(buf.data);
+}
+
+
+void
+record_close(int fd)
+{
+	if (fd >= 0)
+		CloseTransientFile(fd);
+}
+
+
+static void
+append_bytes(void *buf, void *ptr, size_t size)
+{
+	appendBinaryStringInfo((StringInfo) buf, ptr, size);
+}
+
+
+/*
+ * SQL-callable function firing the event triggers for every event recorded
+ * in a file, 'repeat' times over, and returning the number of calls and the
+ * total and maximum execution times (in milliseconds) of each trigger.
+ */
+PG_FUNCTION_INFO_V1(replay);
+Datum
+replay(PG_FUNCTION_ARGS)
+{
+	char *filename = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	int32 repeat = PG_GETARG_INT32(1);
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext old_mcontext;
+	MemoryContext event_mcontext;
+	ReplayState state;
+	StringInfoData buf;
+	FILE *file;
+	ListCell *lc;
+	int i;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to replay events")));
+	if (repeat < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("repeat must be at least 1")));
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo) ||
+		!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	/* Build the result in the per-query context, where it must outlive us. */
+	old_mcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupdesc = CreateTupleDescCopy(tupdesc);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(old_mcontext);
+
+	file = AllocateFile(filename, PG_BINARY_R);
+	if (file == NULL)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open event record file \"%s\": %m", filename)));
+
+	/* Each event is read into a context of its own, reset after it is fired. */
+	event_mcontext = AllocSetContextCreate(CurrentMemoryContext,
+										   "replay event context",
+										   ALLOCSET_DEFAULT_MINSIZE,
+										   ALLOCSET_DEFAULT_INITSIZE,
+										   ALLOCSET_DEFAULT_MAXSIZE);
+	state.mcontext = CurrentMemoryContext;
+	state.triggers = NIL;
+
+	for (i = 0; i < repeat; i++)
+	{
+		rewind(file);
+		old_mcontext = MemoryContextSwitchTo(event_mcontext);
+		initStringInfo(&buf);
+		while (read_record(file, filename, &buf))
+		{
+			const EventInfoDesc *desc;
+			EventInfo *info;
+			char *eventname;
+			char *tag;
+			char *query = NULL;
+			char has_query;
+			int32 nchildren;
+
+			eventname = read_string(&buf);
+			tag = read_string(&buf);
+			read_bytes(&buf, &has_query, sizeof(has_query));
+			if (has_query)
+				query = read_string(&buf);
+			desc = lookup_event_desc(eventname);
+			if (desc == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("unrecognized event \"%s\" in event record file \"%s\"",
+								eventname, filename)));
+
+			info = event_read(desc, read_bytes, &buf);
+			read_bytes(&buf, &nchildren, sizeof(nchildren));
+			while (nchildren-- > 0)
+			{
+				Oid child;
+
+				read_bytes(&buf, &child, sizeof(child));
+				info->children = lappend_oid(info->children, child);
+			}
+
+			ReplayEvent(info, tag, query, replay_timing, &state);
+
+			MemoryContextReset(event_mcontext);
+			initStringInfo(&buf);
+			CHECK_FOR_INTERRUPTS();
+		}
+		MemoryContextSwitchTo(old_mcontext);
+	}
+	FreeFile(file);
+	MemoryContextDelete(event_mcontext);
+
+	foreach(lc, state.triggers)
+	{
+		ReplayTriggerStats *stats = (ReplayTriggerStats *) lfirst(lc);
+		Datum values[5];
+		bool nulls[5];
+
+		memset(nulls, false, sizeof(nulls));
+		values[0] = CStringGetTextDatum(stats->trigname);
+		values[1] = CStringGetTextDatum(stats->eventname);
+		values[2] = Int64GetDatum(stats->calls);
+		values[3] = Float8GetDatum(stats->total_time);
+		values[4] = Float8GetDatum(stats->max_time);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	tuplestore_donestoring(tupstore);
+	return (Datum) 0;
+}
+
+
+/*
+ * Read the next record from the file into 'buf'.  Returns false at the end of
+ * the file.
+ */
+static bool
+read_record(FILE *file, const char *filename, StringInfo buf)
+{
+	RecordHeader header;
+	size_t nread;
+
+	nread = fread(&header, 1, sizeof(header), file);
+	if (nread == 0 && feof(file))
+		return false;
+	if (nread != sizeof(header) || header.magic != RECORD_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("\"%s\" is not an event record file", filename)));
+	if (header.server_version / 100 != PG_VERSION_NUM / 100)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("event record file \"%s\" was recorded by an incompatible server",
+						filename),
+				 errdetail("The file was recorded by server version %u, and this is version %u.",
+						   header.server_version, PG_VERSION_NUM)));
+
+	enlargeStringInfo(buf, header.size);
+	if (fread(buf->data, 1, header.size, file) != header.size)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("event record file \"%s\" is truncated", filename)));
+	buf->len = header.size;
+	buf->cursor = 0;
+	return true;
+}
+
+
+static void
+read_bytes(void *buf, void *ptr, size_t size)
+{
+	StringInfo str = (StringInfo) buf;
+
+	if (size > str->len - str->cursor)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("event record is truncated")));
+	memcpy(ptr, str->data + str->cursor, size);
+	str->cursor += size;
+}
+
+
+static char *
+read_string(StringInfo buf)
+{
+	char *str = buf->data + buf->cursor;
+	char *end = memchr(str, '\0', buf->len - buf->cursor);
+
+	if (end == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("event record is truncated")));
+	buf->cursor += end - str + 1;
+	return str;
+}
+
+
+/* Add a trigger call's execution time to its replay statistics. */
+static void
+replay_timing(Oid trigoid, const char *trigname, const char *eventname,
+			  double elapsed, void *arg)
+{
+	ReplayState *state = (ReplayState *) arg;
+	ReplayTriggerStats *stats = NULL;
+	ListCell *lc;
+
+	foreach(lc, state->triggers)
+	{
+		ReplayTriggerStats *item = (ReplayTriggerStats *) lfirst(lc);
+
+		if (item->trigoid == trigoid)
+		{
+			stats = item;
+			break;
+		}
+	}
+	if (stats == NULL)
+	{
+		MemoryContext old_mcontext = MemoryContextSwitchTo(state->mcontext);
+
+		stats = (ReplayTriggerStats *) palloc0(sizeof(ReplayTriggerStats));
+		stats->trigoid = trigoid;
+		stats->trigname = pstrdup(trigname);
+		stats->eventname = pstrdup(eventname);
+		state->triggers = lappend(state->triggers, stats);
+		MemoryContextSwitchTo(old_mcontext);
+	}
+
+	stats->calls++;
+	stats->total_time += elapsed;
+	stats->max_time = Max(stats->max_time, elapsed);
+}
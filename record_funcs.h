@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * record_funcs.h
+ *    Declarations for recording events to a file, and replaying them.
+ *
+ *
+ * pg_schema_triggers/record_funcs.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_RECORD_FUNCS_H
+#define SCHEMA_TRIGGERS_RECORD_FUNCS_H
+
+
+#include "postgres.h"
+#include "fmgr.h"
+
+
+#include "trigger_funcs.h"
+
+
+extern char *record_file;
+
+
+bool record_enabled(void);
+int record_open(void);
+void record_event(int fd, const EventCommand *command, EventInfo *info);
+void record_close(int fd);
+
+Datum replay(PG_FUNCTION_ARGS);
+
+
+#endif	/* SCHEMA_TRIGGERS_RECORD_FUNCS_H */
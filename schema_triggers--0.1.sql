@@ -5,7 +5,11 @@
 -- Info for relation_create event.
 CREATE TYPE relation_create_eventinfo AS (
 	relation        REGCLASS,
-	new				PG_CATALOG.PG_CLASS
+	new				PG_CATALOG.PG_CLASS,
+	columns			PG_CATALOG.PG_ATTRIBUTE[],
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
 );
 CREATE FUNCTION get_relation_create_eventinfo()
 	RETURNS relation_create_eventinfo
@@ -13,11 +17,32 @@ CREATE FUNCTION get_relation_create_eventinfo()
 	AS 'schema_triggers', 'relation_create_eventinfo';
 
 
+-- Info for relation_create_complete event.
+CREATE TYPE relation_create_complete_eventinfo AS (
+	relation		REGCLASS,
+	new				PG_CATALOG.PG_CLASS,
+	columns			PG_CATALOG.PG_ATTRIBUTE[],
+	defaults		PG_CATALOG.PG_ATTRDEF[],
+	constraints		PG_CATALOG.PG_CONSTRAINT[],
+	indexes			PG_CATALOG.PG_INDEX[],
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
+);
+CREATE FUNCTION get_relation_create_complete_eventinfo()
+	RETURNS relation_create_complete_eventinfo
+	LANGUAGE C
+	AS 'schema_triggers', 'relation_create_complete_eventinfo';
+
+
 -- Info for relation_alter event.
 CREATE TYPE relation_alter_eventinfo AS (
 	relation		REGCLASS,
 	old				PG_CATALOG.PG_CLASS,
-	new				PG_CATALOG.PG_CLASS
+	new				PG_CATALOG.PG_CLASS,
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
 );
 CREATE FUNCTION get_relation_alter_eventinfo()
 	RETURNS relation_alter_eventinfo
@@ -25,10 +50,32 @@ CREATE FUNCTION get_relation_alter_eventinfo()
 	AS 'schema_triggers', 'relation_alter_eventinfo';
 
 
+-- Info for relation_rewrite event.
+CREATE TYPE relation_rewrite_eventinfo AS (
+	relation		REGCLASS,
+	new				PG_CATALOG.PG_CLASS,
+	relpages		INTEGER,
+	reltuples		REAL,
+	size			BIGINT,
+	reason			INTEGER,
+	reasons			TEXT[],
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
+);
+CREATE FUNCTION get_relation_rewrite_eventinfo()
+	RETURNS relation_rewrite_eventinfo
+	LANGUAGE C
+	AS 'schema_triggers', 'relation_rewrite_eventinfo';
+
+
 -- Info for relation_drop event.
 CREATE TYPE relation_drop_eventinfo AS (
 	old_relation_oid REGCLASS,
-	old				PG_CATALOG.PG_CLASS
+	old				PG_CATALOG.PG_CLASS,
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
 );
 CREATE FUNCTION get_relation_drop_eventinfo()
 	RETURNS relation_drop_eventinfo
@@ -40,7 +87,11 @@ CREATE FUNCTION get_relation_drop_eventinfo()
 CREATE TYPE column_add_eventinfo AS (
 	relation		REGCLASS,
 	attnum			INT2,
-	new				PG_CATALOG.PG_ATTRIBUTE
+	new				PG_CATALOG.PG_ATTRIBUTE,
+	children		REGCLASS[],
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
 );
 CREATE FUNCTION get_column_add_eventinfo()
 	RETURNS column_add_eventinfo
@@ -53,7 +104,11 @@ CREATE TYPE column_alter_eventinfo AS (
 	relation		REGCLASS,
 	attnum			INT2,
 	old				PG_CATALOG.PG_ATTRIBUTE,
-	new				PG_CATALOG.PG_ATTRIBUTE
+	new				PG_CATALOG.PG_ATTRIBUTE,
+	children		REGCLASS[],
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
 );
 CREATE FUNCTION get_column_alter_eventinfo()
 	RETURNS column_alter_eventinfo
@@ -65,7 +120,11 @@ CREATE FUNCTION get_column_alter_eventinfo()
 CREATE TYPE column_drop_eventinfo AS (
 	relation		REGCLASS,
 	attnum			INT2,
-	old				PG_CATALOG.PG_ATTRIBUTE
+	old				PG_CATALOG.PG_ATTRIBUTE,
+	children		REGCLASS[],
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
 );
 CREATE FUNCTION get_column_drop_eventinfo()
 	RETURNS column_drop_eventinfo
@@ -77,7 +136,10 @@ CREATE FUNCTION get_column_drop_eventinfo()
 CREATE TYPE trigger_create_eventinfo AS (
 	trigger_oid		OID,
 	is_internal		BOOLEAN,
-	new				PG_CATALOG.PG_TRIGGER
+	new				PG_CATALOG.PG_TRIGGER,
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
 );
 CREATE FUNCTION get_trigger_create_eventinfo()
 	RETURNS trigger_create_eventinfo
@@ -88,9 +150,221 @@ CREATE FUNCTION get_trigger_create_eventinfo()
 -- Info for trigger_drop event.
 CREATE TYPE trigger_drop_eventinfo AS (
 	trigger_oid		OID,
-	old				PG_CATALOG.PG_TRIGGER
+	old				PG_CATALOG.PG_TRIGGER,
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
 );
 CREATE FUNCTION get_trigger_drop_eventinfo()
 	RETURNS trigger_drop_eventinfo
 	LANGUAGE C
 	AS 'schema_triggers', 'trigger_drop_eventinfo';
+
+
+-- Info for ddl_statement_end event;  times are in milliseconds.
+CREATE TYPE ddl_statement_end_eventinfo AS (
+	elapsed			DOUBLE PRECISION,
+	lock_wait		DOUBLE PRECISION,
+	lock_relation	REGCLASS,
+	lock_mode		TEXT,
+	events			INTEGER,
+	catalog_rows	BIGINT,
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
+);
+CREATE FUNCTION get_ddl_statement_end_eventinfo()
+	RETURNS ddl_statement_end_eventinfo
+	LANGUAGE C
+	AS 'schema_triggers', 'ddl_statement_end_eventinfo';
+
+
+-- Per-relation schema version counters, bumped at commit.
+CREATE FUNCTION relation_version(REGCLASS)
+	RETURNS BIGINT
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'relation_version';
+CREATE FUNCTION relation_version(REGCLASS[])
+	RETURNS BIGINT[]
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'relation_versions';
+
+
+-- Per-relation fingerprints over the column names, types, typmods and
+-- nullability, maintained incrementally at commit.
+CREATE FUNCTION relation_fingerprint(REGCLASS)
+	RETURNS BIGINT
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'relation_fingerprint';
+CREATE FUNCTION relation_fingerprint_recompute(REGCLASS)
+	RETURNS BIGINT
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'relation_fingerprint_recompute';
+CREATE VIEW relation_fingerprints AS
+	SELECT c.oid::REGCLASS AS relation,
+		c.relnamespace,
+		relation_version(c.oid::REGCLASS) AS version,
+		relation_fingerprint(c.oid::REGCLASS) AS fingerprint
+	FROM pg_catalog.pg_class c
+		JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace
+	WHERE c.relkind IN ('r', 'v', 'm', 'c', 'f')
+		AND n.nspname NOT IN ('pg_catalog', 'information_schema')
+		AND n.nspname NOT LIKE 'pg\_toast%';
+REVOKE ALL ON relation_fingerprints FROM PUBLIC;
+
+
+-- Wait for a transaction which changed the schema to commit.
+CREATE TYPE schema_change AS (
+	generation		BIGINT,
+	relations		OID[]
+);
+CREATE FUNCTION wait_for_change(since BIGINT, timeout INTERVAL)
+	RETURNS schema_change
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'wait_for_change';
+
+
+-- Cumulative execution times of the event triggers, in milliseconds.
+CREATE FUNCTION get_event_trigger_stats(
+	OUT trigger_oid OID,
+	OUT calls BIGINT,
+	OUT total_time DOUBLE PRECISION,
+	OUT max_time DOUBLE PRECISION,
+	OUT overruns BIGINT)
+	RETURNS SETOF RECORD
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'event_trigger_stats';
+CREATE VIEW event_trigger_stats AS
+	SELECT t.evtname AS trigger,
+		t.evtevent AS event,
+		s.calls,
+		s.total_time,
+		s.max_time,
+		s.overruns
+	FROM get_event_trigger_stats() s
+		JOIN pg_catalog.pg_event_trigger t ON t.oid = s.trigger_oid;
+
+
+-- Cumulative statistics of each event;  times are in milliseconds.
+CREATE FUNCTION get_event_stats(
+	OUT event TEXT,
+	OUT captured BIGINT,
+	OUT fired BIGINT,
+	OUT skipped BIGINT,
+	OUT catalog_fetches BIGINT,
+	OUT total_capture_time DOUBLE PRECISION,
+	OUT max_capture_time DOUBLE PRECISION,
+	OUT total_dispatch_time DOUBLE PRECISION,
+	OUT max_dispatch_time DOUBLE PRECISION,
+	OUT max_queued BIGINT)
+	RETURNS SETOF RECORD
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'event_stats';
+CREATE VIEW pg_stat_schema_triggers AS
+	SELECT * FROM get_event_stats();
+CREATE FUNCTION pg_stat_schema_triggers_reset()
+	RETURNS VOID
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'reset_stats';
+REVOKE ALL ON FUNCTION pg_stat_schema_triggers_reset() FROM PUBLIC;
+
+
+-- This session's timeline of event processing, as Chrome trace-event JSON.
+CREATE FUNCTION dump_trace(reset BOOLEAN DEFAULT true)
+	RETURNS JSON
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'dump_trace';
+
+
+-- Fire the event triggers for the events recorded to a file (by setting
+-- schema_triggers.record_file), and time each trigger in milliseconds.
+CREATE FUNCTION replay(
+	file TEXT,
+	repeat INTEGER DEFAULT 1,
+	OUT trigger TEXT,
+	OUT event TEXT,
+	OUT calls BIGINT,
+	OUT total_time DOUBLE PRECISION,
+	OUT max_time DOUBLE PRECISION)
+	RETURNS SETOF RECORD
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'replay';
+REVOKE ALL ON FUNCTION replay(TEXT, INTEGER) FROM PUBLIC;
+
+
+-- A dry run of DDL, in a subtransaction which is rolled back:  the events it
+-- would raise, the triggers they would fire (which are not run), and the
+-- catalog scans, capture time in milliseconds and queue memory they take.
+CREATE FUNCTION explain(
+	ddl TEXT,
+	OUT event TEXT,
+	OUT events BIGINT,
+	OUT triggers TEXT[],
+	OUT trigger_calls BIGINT,
+	OUT catalog_fetches BIGINT,
+	OUT capture_time DOUBLE PRECISION,
+	OUT queue_bytes BIGINT)
+	RETURNS SETOF RECORD
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'explain_ddl';
+
+
+-- Metadata common to all events.
+CREATE TYPE event_meta AS (
+	event			TEXT,
+	relation		REGCLASS,
+	seqno			BIGINT,
+	xid				XID,
+	stmt_index		INTEGER
+);
+CREATE FUNCTION get_current_event_meta()
+	RETURNS event_meta
+	LANGUAGE C
+	AS 'schema_triggers', 'current_event_meta';
+
+
+-- The utility command which raised the current event.
+CREATE TYPE command_info AS (
+	command_tag		TEXT,
+	query			TEXT
+);
+CREATE FUNCTION get_current_command()
+	RETURNS command_info
+	LANGUAGE C
+	AS 'schema_triggers', 'current_command';
+
+
+-- Number of statements whose event contexts this session still holds.
+CREATE FUNCTION event_context_count()
+	RETURNS INTEGER
+	LANGUAGE C STRICT
+	AS 'schema_triggers', 'event_context_count';
+
+
+-- The current event as a JSONB document (PostgreSQL 9.4 and up).
+DO $$
+BEGIN
+	IF current_setting('server_version_num')::INTEGER >= 90400 THEN
+		CREATE FUNCTION get_current_event_jsonb()
+			RETURNS JSONB
+			LANGUAGE C
+			AS 'schema_triggers', 'current_event_jsonb';
+	END IF;
+END;
+$$;
+
+
+-- Raise relation_rewrite from the server's table_rewrite event (PostgreSQL
+-- 9.5 and up), before the rewrite starts.
+DO $$
+BEGIN
+	IF current_setting('server_version_num')::INTEGER >= 90500 THEN
+		CREATE FUNCTION relation_rewrite_guard()
+			RETURNS EVENT_TRIGGER
+			LANGUAGE C
+			AS 'schema_triggers', 'relation_rewrite_guard';
+		CREATE EVENT TRIGGER schema_triggers_relation_rewrite ON table_rewrite
+			EXECUTE PROCEDURE relation_rewrite_guard();
+	END IF;
+END;
+$$;
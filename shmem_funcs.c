@@ -0,0 +1,1215 @@
+/*
+ * Shared-memory state which outlives the statement (and the backend) that
+ * produced it:  per-relation schema version counters which are bumped when
+ * a transaction that changed the relation's schema commits, per-relation
+ * fingerprints of the columns, which are updated incrementally at commit, and
+ * a log of recently-changed relations for sessions waiting in
+ * wait_for_change(), the cluster-wide event sequence counter, the
+ * cumulative execution times of the event triggers, and the per-event
+ * statistics shown by pg_stat_schema_triggers.
+ *
+ * The shared state only exists when the library is loaded through
+ * shared_preload_libraries;  when it is LOADed into a single session,
+ * changes are not tracked and the SQL-callable functions raise an error.
+ *
+ * pg_schema_triggers/shmem_funcs.c
+ */
+
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "access/hash.h"
+#include "access/htup_details.h"
+#include "access/xact.h"
+#include "catalog/pg_attribute.h"
+#include "catalog/pg_type.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
+
+
+#include "catalog_funcs.h"
+#include "shmem_funcs.h"
+
+
+/* Number of entries in the shared log of recently-changed relations. */
+#define CHANGE_LOG_SIZE 4096
+
+/* An entry in the shared log of recently-changed relations. */
+typedef struct ChangeLogEntry {
+	uint64 generation;
+	Oid relation;
+} ChangeLogEntry;
+
+/* The fixed-size part of our shared memory segment. */
+typedef struct SharedState {
+#if PG_VERSION_NUM < 90400
+	LWLockId lock;
+#else
+	LWLock *lock;
+#endif
+	slock_t mutex;					/* protects event_seqno */
+	uint64 event_seqno;				/* last event sequence number handed out */
+	uint64 version_counter;			/* last version number handed out */
+	uint64 untracked_version;		/* version of relations not in the hash */
+	uint64 generation;				/* number of commits which changed schema */
+	int committing;					/* commits not yet applied;  see below */
+	uint64 change_log_next;			/* number of change_log entries written */
+	ChangeLogEntry change_log[CHANGE_LOG_SIZE];
+	Latch *waiters[FLEXIBLE_ARRAY_MEMBER];	/* max_waiters slots */
+} SharedState;
+
+/* An entry in the shared relation_versions hash table. */
+typedef struct RelationVersionEntry {
+	Oid relation;					/* hash key; must be first */
+	uint64 version;
+	bool has_fingerprint;			/* false until first computed */
+	uint64 fingerprint;
+} RelationVersionEntry;
+
+/* Number of event triggers whose execution times are kept. */
+#define MAX_TRIGGER_STATS 256
+
+/* An entry in the shared trigger_stats hash table. */
+typedef struct TriggerStatsEntry {
+	Oid trigger;					/* hash key; must be first */
+	TriggerStatsCounters counters;
+} TriggerStatsEntry;
+
+/* Number of events whose statistics are kept. */
+#define MAX_EVENT_STATS 64
+
+/* An entry in the shared event_stats hash table. */
+typedef struct EventStatsEntry {
+	char eventname[NAMEDATALEN];	/* hash key */
+	EventStatsCounters counters;
+} EventStatsEntry;
+
+/* A schema change made by the current transaction, applied at commit. */
+typedef struct PendingChange {
+	Oid relation;
+	int nestlevel;
+	RelationChangeKind kind;
+	uint64 fingerprint_delta;		/* XORed into the relation's fingerprint */
+} PendingChange;
+
+/* The parts of a pg_attribute row which contribute to a fingerprint. */
+typedef struct ColumnFingerprintData {
+	uint32 salt;
+	NameData attname;
+	Oid atttypid;
+	int32 atttypmod;
+	bool attnotnull;
+} ColumnFingerprintData;
+
+
+int max_tracked_relations = 10000;
+int max_waiters = 64;
+
+static SharedState *shared = NULL;
+static HTAB *relation_versions = NULL;
+static HTAB *trigger_stats = NULL;
+static HTAB *event_stats_hash = NULL;
+static List *pending_changes = NIL;
+static bool committing = false;		/* counted in shared->committing */
+
+static shmem_startup_hook_type old_shmem_startup_hook = NULL;
+
+static Size shmem_size(void);
+static void shmem_startup(void);
+static void check_shared_state(void);
+static uint64 lookup_relation_version(Oid relation);
+static void fingerprint_column(HeapTuple tuple, void *arg);
+static uint64 compute_relation_fingerprint(Oid relation);
+static bool has_pending_changes(Oid relation);
+static void begin_commit(void);
+static void end_commit(void);
+static void apply_pending_changes(void);
+static int register_waiter(void);
+static void unregister_waiter(int slot);
+static void wake_waiters(void);
+static long interval_to_msec(Interval *interval);
+static ArrayType *changed_relations_since(uint64 since);
+static void xact_callback(XactEvent event, void *arg);
+static void subxact_callback(SubXactEvent event,
+	SubTransactionId mySubid,
+	SubTransactionId parentSubid,
+	void *arg);
+
+
+/*
+ * Request our shared memory and install the shmem_startup hook, along with
+ * the transaction callbacks which apply each transaction's changes at commit.
+ *
+ * Shared memory can only be requested while shared_preload_libraries is
+ * being processed;  otherwise, we quietly run without it.
+ */
+void
+install_shmem_hook()
+{
+	RegisterXactCallback(xact_callback, NULL);
+	RegisterSubXactCallback(subxact_callback, NULL);
+
+	if (!process_shared_preload_libraries_in_progress)
+		return;
+
+	RequestAddinShmemSpace(shmem_size());
+#if PG_VERSION_NUM < 90600
+	RequestAddinLWLocks(1);
+#else
+	RequestNamedLWLockTranche("schema_triggers", 1);
+#endif
+
+	old_shmem_startup_hook = shmem_startup_hook;
+	shmem_startup_hook = shmem_startup;
+}
+
+
+void
+remove_shmem_hook()
+{
+	UnregisterXactCallback(xact_callback, NULL);
+	UnregisterSubXactCallback(subxact_callback, NULL);
+
+	if (shmem_startup_hook == shmem_startup)
+		shmem_startup_hook = old_shmem_startup_hook;
+}
+
+
+static Size
+shmem_size(void)
+{
+	Size size;
+
+	size = MAXALIGN(add_size(offsetof(SharedState, waiters),
+							 mul_size(max_waiters, sizeof(Latch *))));
+	size = add_size(size, hash_estimate_size(max_tracked_relations,
+											 sizeof(RelationVersionEntry)));
+	size = add_size(size, hash_estimate_size(MAX_TRIGGER_STATS,
+											 sizeof(TriggerStatsEntry)));
+	size = add_size(size, hash_estimate_size(MAX_EVENT_STATS,
+											 sizeof(EventStatsEntry)));
+	return size;
+}
+
+
+/*
+ * Create or attach to the shared state.
+ */
+static void
+shmem_startup(void)
+{
+	HASHCTL info;
+	bool found;
+
+	if (old_shmem_startup_hook)
+		old_shmem_startup_hook();
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+	shared = ShmemInitStruct("schema_triggers",
+							 offsetof(SharedState, waiters) + max_waiters * sizeof(Latch *),
+							 &found);
+	if (!found)
+	{
+		int i;
+
+#if PG_VERSION_NUM < 90600
+		shared->lock = LWLockAssign();
+#else
+		shared->lock = &(GetNamedLWLockTranche("schema_triggers"))->lock;
+#endif
+		SpinLockInit(&shared->mutex);
+		shared->event_seqno = 0;
+		shared->version_counter = 0;
+		shared->untracked_version = 0;
+		shared->generation = 0;
+		shared->committing = 0;
+		shared->change_log_next = 0;
+		for (i = 0; i < max_waiters; i++)
+			shared->waiters[i] = NULL;
+	}
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(RelationVersionEntry);
+	info.hash = tag_hash;
+	relation_versions = ShmemInitHash("schema_triggers relation versions",
+									  max_tracked_relations,
+									  max_tracked_relations,
+									  &info,
+									  HASH_ELEM | HASH_FUNCTION);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(Oid);
+	info.entrysize = sizeof(TriggerStatsEntry);
+	info.hash = tag_hash;
+	trigger_stats = ShmemInitHash("schema_triggers trigger stats",
+								  MAX_TRIGGER_STATS,
+								  MAX_TRIGGER_STATS,
+								  &info,
+								  HASH_ELEM | HASH_FUNCTION);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = NAMEDATALEN;
+	info.entrysize = sizeof(EventStatsEntry);
+	event_stats_hash = ShmemInitHash("schema_triggers event stats",
+									 MAX_EVENT_STATS,
+									 MAX_EVENT_STATS,
+									 &info,
+									 HASH_ELEM);
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+static void
+check_shared_state(void)
+{
+	if (shared == NULL || relation_versions == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("schema_triggers must be loaded via shared_preload_libraries")));
+}
+
+
+/*
+ * Hand out the next cluster-wide event sequence number, or 0 if there is no
+ * shared state.
+ */
+uint64
+next_event_seqno(void)
+{
+	volatile SharedState *vshared = shared;
+	uint64 seqno;
+
+	if (shared == NULL)
+		return 0;
+
+	SpinLockAcquire(&vshared->mutex);
+	seqno = ++vshared->event_seqno;
+	SpinLockRelease(&vshared->mutex);
+	return seqno;
+}
+
+
+/*
+ * Remember that the current (sub)transaction created, changed or dropped the
+ * given relation.  If and when the top-level transaction commits, the change
+ * is logged for wait_for_change() and, unless the relation was just created,
+ * the relation's version number is bumped.
+ */
+void
+record_relation_change(Oid relation, RelationChangeKind kind, uint64 fingerprint_delta)
+{
+	MemoryContext old_mcontext;
+	PendingChange *change;
+
+	if (shared == NULL)
+		return;
+
+	old_mcontext = MemoryContextSwitchTo(TopTransactionContext);
+	change = (PendingChange *) palloc(sizeof(*change));
+	change->relation = relation;
+	change->nestlevel = GetCurrentTransactionNestLevel();
+	change->kind = kind;
+	change->fingerprint_delta = fingerprint_delta;
+	pending_changes = lappend(pending_changes, change);
+	MemoryContextSwitchTo(old_mcontext);
+}
+
+
+static bool
+has_pending_changes(Oid relation)
+{
+	ListCell *lc;
+
+	foreach(lc, pending_changes)
+	{
+		PendingChange *change = (PendingChange *) lfirst(lc);
+
+		if (change->relation == relation)
+			return true;
+	}
+	return false;
+}
+
+
+/*
+ * Compute a column's contribution to its relation's fingerprint.  A relation's
+ * fingerprint is the XOR of the contributions of its live user columns, so
+ * adding, altering or dropping a column updates it in O(1).  Note that the
+ * column's position does not contribute;  two tables with the same columns
+ * have the same fingerprint regardless of their history.
+ */
+uint64
+column_fingerprint(const LightPgAttribute *attr)
+{
+	ColumnFingerprintData data;
+	uint64 hi;
+	uint64 lo;
+
+	if (attr->attnum <= 0 || attr->attisdropped)
+		return 0;
+
+	memset(&data, 0, sizeof(data));
+	namecpy(&data.attname, &attr->attname);
+	data.atttypid = attr->atttypid;
+	data.atttypmod = attr->atttypmod;
+	data.attnotnull = attr->attnotnull;
+
+	/* hash_any() only produces 32 bits, so hash twice with different salts. */
+	data.salt = 0;
+	hi = DatumGetUInt32(hash_any((unsigned char *) &data, sizeof(data)));
+	data.salt = 1;
+	lo = DatumGetUInt32(hash_any((unsigned char *) &data, sizeof(data)));
+	return (hi << 32) | lo;
+}
+
+
+/* Add a pg_attribute row's contribution to the fingerprint at 'arg'. */
+static void
+fingerprint_column(HeapTuple tuple, void *arg)
+{
+	CapturedRow row;
+
+	capture_catalog_row(&row, AttributeRelationId, tuple, CAPTURE_OID);
+	*((uint64 *) arg) ^= column_fingerprint(&row.light.pg_attribute);
+}
+
+
+/*
+ * Compute a relation's fingerprint from scratch, using a snapshot that is
+ * taken after the call.
+ */
+static uint64
+compute_relation_fingerprint(Oid relation)
+{
+	Snapshot snapshot;
+	uint64 fingerprint = 0;
+
+	snapshot = RegisterSnapshot(GetLatestSnapshot());
+	pgattribute_scan_range(relation, 1, MaxAttrNumber, snapshot,
+						   fingerprint_column, &fingerprint);
+	UnregisterSnapshot(snapshot);
+	return fingerprint;
+}
+
+
+/*
+ * Look up the version of a relation.  The caller must hold the lock.
+ *
+ * Relations which have not changed since the server started, or which could
+ * not be given an entry because the hash table was full, share a single
+ * version number which is bumped whenever an untracked relation changes.
+ */
+static uint64
+lookup_relation_version(Oid relation)
+{
+	RelationVersionEntry *entry;
+
+	entry = (RelationVersionEntry *) hash_search(relation_versions,
+												 &relation,
+												 HASH_FIND,
+												 NULL);
+	if (entry == NULL)
+		return shared->untracked_version;
+	return entry->version;
+}
+
+
+/*
+ * Count a transaction with pending changes as committing, from before its
+ * catalog changes become visible until apply_pending_changes() has run.  In
+ * between, other sessions can already see the new columns while the old
+ * fingerprint is still remembered, so a fingerprint computed then mustn't be
+ * remembered either:  the change's delta would be applied to it twice.
+ */
+static void
+begin_commit(void)
+{
+	if (shared == NULL || pending_changes == NIL)
+		return;
+
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	shared->committing++;
+	LWLockRelease(shared->lock);
+	committing = true;
+}
+
+
+/* Stop counting the transaction as committing.  The caller holds the lock. */
+static void
+end_commit(void)
+{
+	if (!committing)
+		return;
+
+	Assert(shared->committing > 0);
+	shared->committing--;
+	committing = false;
+}
+
+
+/*
+ * Bump the version of each relation changed by the just-committed transaction.
+ * Every bump takes a fresh value from a single counter, so a relation's version
+ * never goes backwards even if its entry is evicted and later recreated.
+ *
+ * The transaction as a whole gets a new generation number, and each change is
+ * logged under that generation before any waiting sessions are woken.
+ */
+static void
+apply_pending_changes(void)
+{
+	ListCell *lc;
+
+	if (shared == NULL || pending_changes == NIL)
+		return;
+
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	shared->generation++;
+	foreach(lc, pending_changes)
+	{
+		PendingChange *change = (PendingChange *) lfirst(lc);
+		ChangeLogEntry *log_entry;
+		RelationVersionEntry *entry;
+		bool found;
+
+		log_entry = &shared->change_log[shared->change_log_next++ % CHANGE_LOG_SIZE];
+		log_entry->generation = shared->generation;
+		log_entry->relation = change->relation;
+
+		if (change->kind == RELATION_CREATED)
+			continue;
+		if (change->kind == RELATION_DROPPED)
+		{
+			/*
+			 * The relation falls back to the untracked version, which must
+			 * be newer than the one its entry had.
+			 */
+			if (hash_search(relation_versions, &change->relation,
+							HASH_REMOVE, NULL) != NULL)
+				shared->untracked_version = ++shared->version_counter;
+			continue;
+		}
+
+		entry = (RelationVersionEntry *) hash_search(relation_versions,
+													 &change->relation,
+													 HASH_ENTER_NULL,
+													 &found);
+		if (entry == NULL)
+		{
+			/* Out of space;  treat every untracked relation as changed. */
+			shared->untracked_version = ++shared->version_counter;
+			continue;
+		}
+		if (!found)
+		{
+			entry->has_fingerprint = false;
+			entry->fingerprint = 0;
+		}
+		entry->version = ++shared->version_counter;
+		entry->fingerprint ^= change->fingerprint_delta;
+		if (change->kind == RELATION_RESHAPED)
+			entry->has_fingerprint = false;
+	}
+	end_commit();
+	LWLockRelease(shared->lock);
+
+	wake_waiters();
+}
+
+
+/*
+ * Claim a waiter slot for this backend's latch, so that committing
+ * transactions will wake us up.
+ */
+static int
+register_waiter(void)
+{
+	int slot;
+
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	for (slot = 0; slot < max_waiters; slot++)
+	{
+		if (shared->waiters[slot] == NULL)
+		{
+			shared->waiters[slot] = &MyProc->procLatch;
+			break;
+		}
+	}
+	LWLockRelease(shared->lock);
+
+	if (slot == max_waiters)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONFIGURATION_LIMIT_EXCEEDED),
+				 errmsg("too many sessions are waiting for schema changes"),
+				 errhint("Consider increasing schema_triggers.max_waiters.")));
+	return slot;
+}
+
+
+static void
+unregister_waiter(int slot)
+{
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	shared->waiters[slot] = NULL;
+	LWLockRelease(shared->lock);
+}
+
+
+static void
+wake_waiters(void)
+{
+	int slot;
+
+	LWLockAcquire(shared->lock, LW_SHARED);
+	for (slot = 0; slot < max_waiters; slot++)
+	{
+		if (shared->waiters[slot] != NULL)
+			SetLatch(shared->waiters[slot]);
+	}
+	LWLockRelease(shared->lock);
+}
+
+
+static int
+oid_cmp(const void *a, const void *b)
+{
+	Oid oa = *((const Oid *) a);
+	Oid ob = *((const Oid *) b);
+
+	if (oa < ob)
+		return -1;
+	if (oa > ob)
+		return 1;
+	return 0;
+}
+
+
+/*
+ * Return the distinct relations changed by generations after 'since', in Oid
+ * order, or NULL if some of those changes have already dropped out of the log.
+ * The caller must hold the lock.
+ */
+static ArrayType *
+changed_relations_since(uint64 since)
+{
+	uint64 first;
+	uint64 i;
+	Datum *elems;
+	Oid *relations;
+	int nrelations = 0;
+	int nelems = 0;
+
+	first = (shared->change_log_next > CHANGE_LOG_SIZE) ?
+		shared->change_log_next - CHANGE_LOG_SIZE : 0;
+	if (first > 0 && shared->change_log[first % CHANGE_LOG_SIZE].generation > since)
+		return NULL;
+
+	relations = (Oid *) palloc(CHANGE_LOG_SIZE * sizeof(Oid));
+	for (i = first; i < shared->change_log_next; i++)
+	{
+		ChangeLogEntry *log_entry = &shared->change_log[i % CHANGE_LOG_SIZE];
+
+		if (log_entry->generation > since)
+			relations[nrelations++] = log_entry->relation;
+	}
+
+	/* Sort and remove duplicates. */
+	qsort(relations, nrelations, sizeof(Oid), oid_cmp);
+	elems = (Datum *) palloc((nrelations + 1) * sizeof(Datum));
+	for (i = 0; i < nrelations; i++)
+	{
+		if (i > 0 && relations[i] == relations[i - 1])
+			continue;
+		elems[nelems++] = ObjectIdGetDatum(relations[i]);
+	}
+	pfree(relations);
+
+	return construct_array(elems, nelems, OIDOID, sizeof(Oid), true, 'i');
+}
+
+
+static long
+interval_to_msec(Interval *interval)
+{
+	float8 secs;
+
+	secs = DatumGetFloat8(DirectFunctionCall2(interval_part,
+											  CStringGetTextDatum("epoch"),
+											  IntervalPGetDatum(interval)));
+	if (secs <= 0)
+		return 0;
+	if (secs >= INT_MAX / 1000)
+		return INT_MAX;
+	return (long) (secs * 1000);
+}
+
+
+/*
+ * Apply the pending changes once the transaction has committed, and forget
+ * about them otherwise.
+ *
+ * XXX:  changes made by a transaction that is later committed with COMMIT
+ * PREPARED are not tracked.
+ */
+static void
+xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+			begin_commit();
+			break;
+
+		case XACT_EVENT_COMMIT:
+			apply_pending_changes();
+			pending_changes = NIL;
+			break;
+
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PREPARE:
+			if (committing)
+			{
+				LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+				end_commit();
+				LWLockRelease(shared->lock);
+			}
+			pending_changes = NIL;
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+/*
+ * On subtransaction abort, discard the changes it made;  on subtransaction
+ * commit, hand its changes to the parent.
+ */
+static void
+subxact_callback(SubXactEvent event,
+	SubTransactionId mySubid,
+	SubTransactionId parentSubid,
+	void *arg)
+{
+	int nestlevel = GetCurrentTransactionNestLevel();
+	MemoryContext old_mcontext;
+	List *kept = NIL;
+	ListCell *lc;
+
+	if (pending_changes == NIL)
+		return;
+
+	switch (event)
+	{
+		case SUBXACT_EVENT_COMMIT_SUB:
+			foreach(lc, pending_changes)
+			{
+				PendingChange *change = (PendingChange *) lfirst(lc);
+
+				if (change->nestlevel >= nestlevel)
+					change->nestlevel = nestlevel - 1;
+			}
+			break;
+
+		case SUBXACT_EVENT_ABORT_SUB:
+			old_mcontext = MemoryContextSwitchTo(TopTransactionContext);
+			foreach(lc, pending_changes)
+			{
+				PendingChange *change = (PendingChange *) lfirst(lc);
+
+				if (change->nestlevel < nestlevel)
+					kept = lappend(kept, change);
+			}
+			list_free(pending_changes);
+			pending_changes = kept;
+			MemoryContextSwitchTo(old_mcontext);
+			break;
+
+		default:
+			break;
+	}
+}
+
+
+/*
+ * SQL-callable functions to read a relation's schema version.
+ */
+PG_FUNCTION_INFO_V1(relation_version);
+Datum
+relation_version(PG_FUNCTION_ARGS)
+{
+	Oid relation = PG_GETARG_OID(0);
+	uint64 version;
+
+	check_shared_state();
+
+	LWLockAcquire(shared->lock, LW_SHARED);
+	version = lookup_relation_version(relation);
+	LWLockRelease(shared->lock);
+
+	PG_RETURN_INT64((int64) version);
+}
+
+
+PG_FUNCTION_INFO_V1(relation_versions);
+Datum
+relation_versions(PG_FUNCTION_ARGS)
+{
+	ArrayType *relations = PG_GETARG_ARRAYTYPE_P(0);
+	Datum *elems;
+	bool *nulls;
+	int nelems;
+	Datum *result;
+	int dims[1];
+	int lbs[1];
+	int i;
+
+	check_shared_state();
+
+	if (ARR_NDIM(relations) > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+				 errmsg("array of relations must be one-dimensional")));
+	deconstruct_array(relations, ARR_ELEMTYPE(relations),
+					  sizeof(Oid), true, 'i',
+					  &elems, &nulls, &nelems);
+
+	/* Look up every relation while holding the lock just once. */
+	result = (Datum *) palloc(nelems * sizeof(Datum));
+	LWLockAcquire(shared->lock, LW_SHARED);
+	for (i = 0; i < nelems; i++)
+	{
+		if (nulls[i])
+			result[i] = (Datum) 0;
+		else
+			result[i] = Int64GetDatum((int64) lookup_relation_version(DatumGetObjectId(elems[i])));
+	}
+	LWLockRelease(shared->lock);
+
+	dims[0] = nelems;
+	lbs[0] = 1;
+	if (nelems == 0)
+		PG_RETURN_ARRAYTYPE_P(construct_empty_array(INT8OID));
+	PG_RETURN_ARRAYTYPE_P(construct_md_array(result, nulls, 1, dims, lbs,
+											 INT8OID, sizeof(int64),
+											 FLOAT8PASSBYVAL, 'd'));
+}
+
+
+/*
+ * SQL-callable functions to read a relation's fingerprint.
+ *
+ * A fingerprint which isn't yet known is computed from pg_attribute.  It is
+ * remembered only in an entry the relation already has (because it has been
+ * changed), so that merely reading fingerprints can't fill the table;  and not
+ * if the relation changed while we were computing it, has uncommitted changes
+ * in this transaction, or some transaction is committing changes which haven't
+ * been applied yet.  (In each of those cases the remembered value might not
+ * match the committed schema once the changes are applied.)
+ */
+PG_FUNCTION_INFO_V1(relation_fingerprint);
+Datum
+relation_fingerprint(PG_FUNCTION_ARGS)
+{
+	Oid relation = PG_GETARG_OID(0);
+	RelationVersionEntry *entry;
+	uint64 version;
+	uint64 fingerprint;
+
+	check_shared_state();
+
+	/* Fast path:  the fingerprint is already known. */
+	LWLockAcquire(shared->lock, LW_SHARED);
+	entry = (RelationVersionEntry *) hash_search(relation_versions,
+												 &relation,
+												 HASH_FIND,
+												 NULL);
+	if (entry != NULL && entry->has_fingerprint)
+	{
+		fingerprint = entry->fingerprint;
+		LWLockRelease(shared->lock);
+		PG_RETURN_INT64((int64) fingerprint);
+	}
+	version = lookup_relation_version(relation);
+	LWLockRelease(shared->lock);
+
+	/* Compute it, and remember it if that's safe. */
+	fingerprint = compute_relation_fingerprint(relation);
+	if (has_pending_changes(relation))
+		PG_RETURN_INT64((int64) fingerprint);
+
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	entry = (RelationVersionEntry *) hash_search(relation_versions,
+												 &relation,
+												 HASH_FIND,
+												 NULL);
+	if (entry != NULL && entry->version == version && shared->committing == 0)
+	{
+		entry->fingerprint = fingerprint;
+		entry->has_fingerprint = true;
+	}
+	LWLockRelease(shared->lock);
+
+	PG_RETURN_INT64((int64) fingerprint);
+}
+
+
+PG_FUNCTION_INFO_V1(relation_fingerprint_recompute);
+Datum
+relation_fingerprint_recompute(PG_FUNCTION_ARGS)
+{
+	Oid relation = PG_GETARG_OID(0);
+
+	PG_RETURN_INT64((int64) compute_relation_fingerprint(relation));
+}
+
+
+/*
+ * Block until a transaction which changed the schema commits after generation
+ * 'since', or until the timeout expires.  Returns the current generation along
+ * with the relations changed since 'since' (NULL if they are no longer known,
+ * in which case the caller should assume that everything changed).
+ */
+PG_FUNCTION_INFO_V1(wait_for_change);
+Datum
+wait_for_change(PG_FUNCTION_ARGS)
+{
+	uint64 since = (uint64) PG_GETARG_INT64(0);
+	long timeout = interval_to_msec(PG_GETARG_INTERVAL_P(1));
+	TimestampTz start = GetCurrentTimestamp();
+	TupleDesc tupdesc;
+	Datum result[2];
+	bool result_isnull[2];
+	uint64 generation = 0;
+	ArrayType *relations = NULL;
+	int slot;
+
+	check_shared_state();
+
+	/* Get the tupdesc for our return type. */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("function returning record called in context "
+				        "that cannot accept type record")));
+	BlessTupleDesc(tupdesc);
+
+	/*
+	 * Register before looking at the generation, so that a commit which
+	 * happens after we look is guaranteed to set our latch.
+	 */
+	slot = register_waiter();
+	PG_TRY();
+	{
+		for (;;)
+		{
+			long secs;
+			int usecs;
+			long remaining;
+			int rc;
+
+			ResetLatch(&MyProc->procLatch);
+
+			LWLockAcquire(shared->lock, LW_SHARED);
+			generation = shared->generation;
+			if (generation > since)
+				relations = changed_relations_since(since);
+			LWLockRelease(shared->lock);
+			if (generation > since)
+				break;
+
+			TimestampDifference(start, GetCurrentTimestamp(), &secs, &usecs);
+			remaining = timeout - (secs * 1000 + usecs / 1000);
+			if (remaining <= 0)
+				break;
+
+			rc = WaitLatch(&MyProc->procLatch,
+						   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+						   remaining);
+			if (rc & WL_POSTMASTER_DEATH)
+				proc_exit(1);
+			CHECK_FOR_INTERRUPTS();
+		}
+	}
+	PG_CATCH();
+	{
+		unregister_waiter(slot);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+	unregister_waiter(slot);
+
+	/* No changes before the timeout is an empty list, not an unknown one. */
+	if (generation <= since)
+		relations = construct_empty_array(OIDOID);
+
+	/* Form and return the tuple. */
+	result[0] = Int64GetDatum((int64) generation);
+	result[1] = PointerGetDatum(relations);
+	result_isnull[0] = false;
+	result_isnull[1] = (relations == NULL);
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, result, result_isnull)));
+}
+
+
+/*
+ * Add the calls of an event trigger made by one statement to its statistics.
+ * Calls are not counted once MAX_TRIGGER_STATS triggers have entries, nor when
+ * there is no shared state;  the first time a backend finds the table full, it
+ * says so.
+ */
+void
+record_trigger_stats(Oid trigger, const TriggerStatsCounters *counters)
+{
+	static bool warned_full = false;
+	TriggerStatsEntry *entry;
+	bool found;
+
+	if (shared == NULL || trigger_stats == NULL)
+		return;
+
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	entry = (TriggerStatsEntry *) hash_search(trigger_stats, &trigger,
+											  HASH_ENTER_NULL, &found);
+	if (entry != NULL)
+	{
+		TriggerStatsCounters *totals = &entry->counters;
+
+		if (!found)
+			memset(totals, 0, sizeof(TriggerStatsCounters));
+		totals->calls += counters->calls;
+		totals->overruns += counters->overruns;
+		totals->total_time += counters->total_time;
+		totals->max_time = Max(totals->max_time, counters->max_time);
+	}
+	LWLockRelease(shared->lock);
+
+	if (entry == NULL && !warned_full)
+	{
+		warned_full = true;
+		ereport(WARNING,
+				(errmsg("statistics are kept for at most %d event triggers",
+						MAX_TRIGGER_STATS),
+				 errdetail("Calls of event trigger %u are not counted.", trigger),
+				 errhint("Drop unused event triggers, or reset the statistics with pg_stat_schema_triggers_reset().")));
+	}
+}
+
+
+/*
+ * Discard the statistics of an event trigger which is being dropped.  They are
+ * gone even if the drop is rolled back, in which case the trigger's counts
+ * start again from zero.
+ */
+void
+forget_trigger_stats(Oid trigger)
+{
+	if (shared == NULL || trigger_stats == NULL)
+		return;
+
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	hash_search(trigger_stats, &trigger, HASH_REMOVE, NULL);
+	LWLockRelease(shared->lock);
+}
+
+
+/*
+ * SQL-callable function returning the statistics of every event trigger which
+ * has been called, as (trigger, calls, total_time, max_time, overruns).
+ */
+PG_FUNCTION_INFO_V1(event_trigger_stats);
+Datum
+event_trigger_stats(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext old_mcontext;
+	HASH_SEQ_STATUS status;
+	TriggerStatsEntry *entry;
+
+	check_shared_state();
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo) ||
+		!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	/* Build the result in the per-query context, where it must outlive us. */
+	old_mcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupdesc = CreateTupleDescCopy(tupdesc);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(old_mcontext);
+
+	LWLockAcquire(shared->lock, LW_SHARED);
+	hash_seq_init(&status, trigger_stats);
+	while ((entry = (TriggerStatsEntry *) hash_seq_search(&status)) != NULL)
+	{
+		Datum values[5];
+		bool nulls[5];
+
+		memset(nulls, false, sizeof(nulls));
+		values[0] = ObjectIdGetDatum(entry->trigger);
+		values[1] = Int64GetDatum(entry->counters.calls);
+		values[2] = Float8GetDatum(entry->counters.total_time);
+		values[3] = Float8GetDatum(entry->counters.max_time);
+		values[4] = Int64GetDatum(entry->counters.overruns);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+	LWLockRelease(shared->lock);
+
+	tuplestore_donestoring(tupstore);
+	return (Datum) 0;
+}
+
+
+/*
+ * Add the statistics gathered for an event by one statement to the event's
+ * totals.  As with record_trigger_stats(), nothing is kept once
+ * MAX_EVENT_STATS events have entries, nor when there is no shared state.
+ */
+void
+record_event_stats(const char *eventname, const EventStatsCounters *counters)
+{
+	EventStatsEntry *entry;
+	char key[NAMEDATALEN];
+	bool found;
+
+	if (shared == NULL || event_stats_hash == NULL)
+		return;
+
+	memset(key, 0, sizeof(key));
+	strlcpy(key, eventname, sizeof(key));
+
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	entry = (EventStatsEntry *) hash_search(event_stats_hash, key,
+											HASH_ENTER_NULL, &found);
+	if (entry != NULL)
+	{
+		EventStatsCounters *totals = &entry->counters;
+
+		if (!found)
+			memset(totals, 0, sizeof(EventStatsCounters));
+		totals->captured += counters->captured;
+		totals->fired += counters->fired;
+		totals->skipped += counters->skipped;
+		totals->catalog_fetches += counters->catalog_fetches;
+		totals->capture_time += counters->capture_time;
+		totals->max_capture_time = Max(totals->max_capture_time, counters->max_capture_time);
+		totals->dispatch_time += counters->dispatch_time;
+		totals->max_dispatch_time = Max(totals->max_dispatch_time, counters->max_dispatch_time);
+		totals->max_queued = Max(totals->max_queued, counters->max_queued);
+	}
+	LWLockRelease(shared->lock);
+}
+
+
+/*
+ * SQL-callable function returning the statistics of every event which has
+ * been raised, as shown by the pg_stat_schema_triggers view.
+ */
+PG_FUNCTION_INFO_V1(event_stats);
+Datum
+event_stats(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext old_mcontext;
+	HASH_SEQ_STATUS status;
+	EventStatsEntry *entry;
+
+	check_shared_state();
+
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo) ||
+		!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	/* Build the result in the per-query context, where it must outlive us. */
+	old_mcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+	tupdesc = CreateTupleDescCopy(tupdesc);
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(old_mcontext);
+
+	LWLockAcquire(shared->lock, LW_SHARED);
+	hash_seq_init(&status, event_stats_hash);
+	while ((entry = (EventStatsEntry *) hash_seq_search(&status)) != NULL)
+	{
+		EventStatsCounters *totals = &entry->counters;
+		Datum values[10];
+		bool nulls[10];
+
+		memset(nulls, false, sizeof(nulls));
+		values[0] = CStringGetTextDatum(entry->eventname);
+		values[1] = Int64GetDatum(totals->captured);
+		values[2] = Int64GetDatum(totals->fired);
+		values[3] = Int64GetDatum(totals->skipped);
+		values[4] = Int64GetDatum(totals->catalog_fetches);
+		values[5] = Float8GetDatum(totals->capture_time);
+		values[6] = Float8GetDatum(totals->max_capture_time);
+		values[7] = Float8GetDatum(totals->dispatch_time);
+		values[8] = Float8GetDatum(totals->max_dispatch_time);
+		values[9] = Int64GetDatum(totals->max_queued);
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+	LWLockRelease(shared->lock);
+
+	tuplestore_donestoring(tupstore);
+	return (Datum) 0;
+}
+
+
+/*
+ * SQL-callable function discarding the statistics of the events and of the
+ * event triggers.
+ */
+PG_FUNCTION_INFO_V1(reset_stats);
+Datum
+reset_stats(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS status;
+	void *entry;
+
+	check_shared_state();
+
+	LWLockAcquire(shared->lock, LW_EXCLUSIVE);
+	hash_seq_init(&status, event_stats_hash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+		hash_search(event_stats_hash, entry, HASH_REMOVE, NULL);
+	hash_seq_init(&status, trigger_stats);
+	while ((entry = hash_seq_search(&status)) != NULL)
+		hash_search(trigger_stats, entry, HASH_REMOVE, NULL);
+	LWLockRelease(shared->lock);
+
+	PG_RETURN_VOID();
+}
@@ -0,0 +1,76 @@
+/*-------------------------------------------------------------------------
+ *
+ * shmem_funcs.h
+ *    Declarations for shared-memory state and commit-time bookkeeping.
+ *
+ *
+ * pg_schema_triggers/shmem_funcs.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_SHMEM_FUNCS_H
+#define SCHEMA_TRIGGERS_SHMEM_FUNCS_H
+
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "access/htup.h"
+
+#include "catalog_funcs.h"
+
+
+/* The ways in which a transaction can change a relation. */
+typedef enum RelationChangeKind {
+	RELATION_CREATED,
+	RELATION_ALTERED,
+	RELATION_RESHAPED,			/* altered, but the fingerprint must be recomputed */
+	RELATION_DROPPED
+} RelationChangeKind;
+
+
+/* The statistics kept for each event, as shown by pg_stat_schema_triggers. */
+typedef struct EventStatsCounters {
+	int64 captured;					/* events enqueued */
+	int64 fired;					/* events passed to at least one trigger */
+	int64 skipped;					/* events which had no triggers to fire */
+	int64 catalog_fetches;			/* catalog scans made to capture them */
+	double capture_time;			/* in milliseconds */
+	double max_capture_time;
+	double dispatch_time;			/* likewise, spent running the triggers */
+	double max_dispatch_time;
+	int64 max_queued;				/* most events queued by one statement */
+} EventStatsCounters;
+
+/* The statistics kept for each event trigger, as shown by event_trigger_stats. */
+typedef struct TriggerStatsCounters {
+	int64 calls;
+	int64 overruns;					/* calls which ran past the budget */
+	double total_time;				/* in milliseconds */
+	double max_time;
+} TriggerStatsCounters;
+
+
+extern int max_tracked_relations;
+extern int max_waiters;
+
+
+void install_shmem_hook(void);
+void remove_shmem_hook(void);
+uint64 next_event_seqno(void);
+void record_relation_change(Oid relation, RelationChangeKind kind, uint64 fingerprint_delta);
+uint64 column_fingerprint(const LightPgAttribute *attr);
+void record_trigger_stats(Oid trigger, const TriggerStatsCounters *counters);
+void forget_trigger_stats(Oid trigger);
+void record_event_stats(const char *eventname, const EventStatsCounters *counters);
+
+Datum relation_version(PG_FUNCTION_ARGS);
+Datum relation_versions(PG_FUNCTION_ARGS);
+Datum relation_fingerprint(PG_FUNCTION_ARGS);
+Datum event_trigger_stats(PG_FUNCTION_ARGS);
+Datum event_stats(PG_FUNCTION_ARGS);
+Datum reset_stats(PG_FUNCTION_ARGS);
+Datum relation_fingerprint_recompute(PG_FUNCTION_ARGS);
+Datum wait_for_change(PG_FUNCTION_ARGS);
+
+
+#endif	/* SCHEMA_TRIGGERS_SHMEM_FUNCS_H */
@@ -0,0 +1,67 @@
+# Concurrent DDL in several sessions, with event triggers dropped while other
+# sessions run DDL.  Each session's events are fired by its own statements, and
+# only the events of committed transactions are logged.
+
+setup
+{
+	CREATE EXTENSION schema_triggers;
+	CREATE TABLE event_log (event TEXT, relname NAME);
+	CREATE FUNCTION log_relation_create()
+	 RETURNS event_trigger
+	 LANGUAGE plpgsql
+	 AS $$
+		BEGIN
+			INSERT INTO event_log VALUES ('relation_create',
+				((schema_triggers.get_relation_create_eventinfo()).new).relname);
+		END;
+	$$;
+	CREATE FUNCTION log_relation_drop()
+	 RETURNS event_trigger
+	 LANGUAGE plpgsql
+	 AS $$
+		BEGIN
+			INSERT INTO event_log VALUES ('relation_drop',
+				((schema_triggers.get_relation_drop_eventinfo()).old).relname);
+		END;
+	$$;
+	CREATE EVENT TRIGGER log_create ON relation_create
+		EXECUTE PROCEDURE log_relation_create();
+	CREATE EVENT TRIGGER log_drop ON relation_drop
+		EXECUTE PROCEDURE log_relation_drop();
+}
+
+teardown
+{
+	DROP TABLE IF EXISTS tenant1, tenant2;
+	DROP EVENT TRIGGER IF EXISTS log_create;
+	DROP EVENT TRIGGER IF EXISTS log_drop;
+	DROP FUNCTION log_relation_create();
+	DROP FUNCTION log_relation_drop();
+	DROP TABLE event_log;
+	DROP EXTENSION schema_triggers;
+}
+
+session "s1"
+step "s1b"		{ BEGIN; }
+step "s1c"		{ CREATE TABLE tenant1 (a INTEGER); }
+step "s1d"		{ DROP TABLE tenant1; }
+step "s1commit"	{ COMMIT; }
+
+session "s2"
+step "s2b"		{ BEGIN; }
+step "s2c"		{ CREATE TABLE tenant2 (a INTEGER); }
+step "s2commit"	{ COMMIT; }
+step "s2rollback"	{ ROLLBACK; }
+
+session "s3"
+step "s3b"		{ BEGIN; }
+step "s3drop"	{ DROP EVENT TRIGGER log_create; }
+step "s3commit"	{ COMMIT; }
+step "check"	{ SELECT relname, event FROM event_log ORDER BY 1, 2; }
+
+# Two sessions creating tables at once;  the second rolls back.
+permutation "s1b" "s2b" "s1c" "s2c" "s1d" "s2rollback" "s1commit" "check"
+
+# A trigger dropped while a session runs DDL:  that session still sees it
+# until the drop commits, and later statements do not.
+permutation "s3b" "s3drop" "s1b" "s1c" "s3commit" "s2b" "s2c" "s1d" "s1commit" "s2commit" "check"
@@ -0,0 +1,47 @@
+# A DDL statement queued behind another session's lock:  its ddl_statement_end
+# event shows the time spent waiting, and the lock it waited for.
+
+setup
+{
+	CREATE EXTENSION schema_triggers;
+	CREATE TABLE waited (a INTEGER);
+	CREATE TABLE stmt_log (command TEXT, waited BOOLEAN, lock_relation REGCLASS, lock_mode TEXT);
+	CREATE FUNCTION log_statement_end()
+	 RETURNS event_trigger
+	 LANGUAGE plpgsql
+	 AS $$
+		DECLARE
+			info schema_triggers.ddl_statement_end_eventinfo;
+		BEGIN
+			info := schema_triggers.get_ddl_statement_end_eventinfo();
+			INSERT INTO stmt_log VALUES (tg_tag,
+				info.lock_wait >= 100 AND info.elapsed >= info.lock_wait,
+				info.lock_relation, info.lock_mode);
+		END;
+	$$;
+	CREATE EVENT TRIGGER log_end ON ddl_statement_end
+		EXECUTE PROCEDURE log_statement_end();
+}
+
+teardown
+{
+	DROP EVENT TRIGGER log_end;
+	DROP FUNCTION log_statement_end();
+	DROP TABLE stmt_log;
+	DROP TABLE waited;
+	DROP EXTENSION schema_triggers;
+}
+
+session "s1"
+step "s1lock"	{ BEGIN; LOCK TABLE waited IN ACCESS SHARE MODE; }
+step "s1sleep"	{ DO $$ BEGIN PERFORM pg_sleep(0.3); END; $$; }
+step "s1commit"	{ COMMIT; }
+
+session "s2"
+setup			{ SET schema_triggers.lock_sample_interval = 5; }
+step "s2alter"	{ ALTER TABLE waited ADD COLUMN b INTEGER; }
+step "s2comment"	{ COMMENT ON TABLE waited IS 'not waited'; }
+step "check"	{ SELECT * FROM stmt_log; }
+
+# The ALTER TABLE waits for s1's lock, the COMMENT doesn't.
+permutation "s1lock" "s2alter" "s1sleep" "s1commit" "s2comment" "check"
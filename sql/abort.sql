@@ -0,0 +1,76 @@
+CREATE EXTENSION schema_triggers;
+\set VERBOSITY terse
+
+-- An event trigger which fails for some tables, and runs DDL of its own for
+-- others.
+CREATE FUNCTION on_relation_create()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		relname TEXT := ((schema_triggers.get_relation_create_eventinfo()).new).relname;
+	BEGIN
+		IF relname LIKE 'fail%' THEN
+			RAISE EXCEPTION 'failing on %', relname;
+		ELSIF relname LIKE 'nest%' THEN
+			CREATE TABLE fail_nested();
+		ELSIF relname LIKE 'catch%' THEN
+			BEGIN
+				CREATE TABLE fail_caught();
+			EXCEPTION WHEN raise_exception THEN
+				RAISE NOTICE 'caught: %', SQLERRM;
+			END;
+		END IF;
+		RAISE NOTICE 'relation_create: %, contexts: %', relname,
+			schema_triggers.event_context_count();
+	END;
+$$;
+CREATE EVENT TRIGGER relcreate ON relation_create
+	EXECUTE PROCEDURE on_relation_create();
+
+-- An error from a trigger aborts the statement, and frees its context.
+CREATE TABLE fail1();
+SELECT schema_triggers.event_context_count();
+CREATE TABLE ok1();
+
+-- Likewise for an error from a statement run by a trigger, whether or not the
+-- trigger catches it.
+CREATE TABLE nest1();
+SELECT schema_triggers.event_context_count();
+CREATE TABLE catch1();
+DO $$
+BEGIN
+	BEGIN
+		CREATE TABLE fail2();
+	EXCEPTION WHEN raise_exception THEN
+		RAISE NOTICE 'caught: %, contexts: %', SQLERRM,
+			schema_triggers.event_context_count();
+	END;
+	CREATE TABLE ok2();
+END;
+$$;
+
+-- The events queued by a statement which fails are discarded, not fired.
+CREATE TABLE ok3 AS SELECT 1 / (random() * 0)::INTEGER AS a;
+SELECT schema_triggers.event_context_count();
+
+-- Rolling back a subtransaction leaves later statements' events alone.
+BEGIN;
+SAVEPOINT a;
+CREATE TABLE ok4();
+ROLLBACK TO a;
+CREATE TABLE fail3();
+ROLLBACK TO a;
+CREATE TABLE ok5();
+COMMIT;
+SELECT schema_triggers.event_context_count();
+SELECT relname FROM pg_class WHERE relname ~ '^(ok|catch|nest|fail)' ORDER BY 1;
+
+-- Clean up.
+DROP EVENT TRIGGER relcreate;
+DROP FUNCTION on_relation_create();
+DROP TABLE ok1;
+DROP TABLE catch1;
+DROP TABLE ok2;
+DROP TABLE ok5;
+DROP EXTENSION schema_triggers;
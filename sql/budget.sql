@@ -0,0 +1,58 @@
+CREATE EXTENSION schema_triggers;
+\set VERBOSITY terse
+
+-- An event trigger which takes its time.
+CREATE FUNCTION slow_relation_create()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		PERFORM pg_sleep(0.2);
+	END;
+$$;
+
+-- In warn mode, running past the budget is only reported and counted.
+CREATE EVENT TRIGGER slow ON relation_create
+	WHEN budget IN ('50ms') AND overrun IN ('warn')
+	EXECUTE PROCEDURE slow_relation_create();
+CREATE TABLE foo();
+SELECT trigger, event, calls, overruns, total_time >= 200 AS total_ok, max_time >= 200 AS max_ok
+	FROM schema_triggers.event_trigger_stats;
+DROP EVENT TRIGGER slow;
+
+-- Otherwise it is an error, and the statement is rolled back.
+CREATE EVENT TRIGGER slow ON relation_create
+	WHEN budget IN ('50ms')
+	EXECUTE PROCEDURE slow_relation_create();
+CREATE TABLE bar();
+SELECT relname FROM pg_class WHERE relname = 'bar';
+SELECT trigger, event, calls, overruns
+	FROM schema_triggers.event_trigger_stats;
+
+-- A trigger within its budget is only counted.
+DROP EVENT TRIGGER slow;
+CREATE EVENT TRIGGER slow ON relation_create
+	WHEN budget IN ('1min')
+	EXECUTE PROCEDURE slow_relation_create();
+CREATE TABLE bar();
+SELECT trigger, event, calls, overruns
+	FROM schema_triggers.event_trigger_stats;
+
+-- Exercise the various cases that shouldn't work.
+CREATE EVENT TRIGGER wont_work ON relation_create
+	WHEN budget IN ('soon')
+	EXECUTE PROCEDURE slow_relation_create();
+CREATE EVENT TRIGGER wont_work ON relation_create
+	WHEN overrun IN ('ignore')
+	EXECUTE PROCEDURE slow_relation_create();
+
+-- Dropping a trigger discards its statistics.
+SELECT oid AS slow_oid FROM pg_event_trigger WHERE evtname = 'slow' \gset
+DROP EVENT TRIGGER slow;
+SELECT count(*) FROM schema_triggers.get_event_trigger_stats() WHERE trigger_oid = :slow_oid;
+
+-- Clean up.
+DROP FUNCTION slow_relation_create();
+DROP TABLE foo;
+DROP TABLE bar;
+DROP EXTENSION schema_triggers;
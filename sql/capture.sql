@@ -0,0 +1,78 @@
+CREATE EXTENSION schema_triggers;
+
+-- Report how much of the pg_class rows were captured.
+CREATE FUNCTION on_relation_alter()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		event_info SCHEMA_TRIGGERS.RELATION_ALTER_EVENTINFO;
+	BEGIN
+		event_info := schema_triggers.get_relation_alter_eventinfo();
+		RAISE NOTICE 'on_relation_alter(%): old.relname=%, new.relname=%, new.relkind=%, new.relnatts=%',
+			event_info.relation, (event_info.old).relname, (event_info.new).relname,
+			(event_info.new).relkind, (event_info.new).relnatts;
+	END;
+$$;
+CREATE TABLE foo(a INTEGER);
+
+-- With only capture=oid triggers, the rows themselves are not kept.
+CREATE EVENT TRIGGER relalter_oid ON relation_alter
+	WHEN capture IN ('oid')
+	EXECUTE PROCEDURE on_relation_alter();
+ALTER TABLE foo RENAME TO foo2;
+
+-- A capture=light trigger gets the name, namespace, kind, persistence and
+-- owner;  the event is captured at the highest level any trigger asks for.
+CREATE EVENT TRIGGER relalter_light ON relation_alter
+	WHEN capture IN ('light')
+	EXECUTE PROCEDURE on_relation_alter();
+ALTER TABLE foo2 RENAME TO foo3;
+
+-- Triggers without a capture option get the whole rows.
+CREATE EVENT TRIGGER relalter_full ON relation_alter
+	EXECUTE PROCEDURE on_relation_alter();
+ALTER TABLE foo3 RENAME TO foo4;
+
+-- Disabled triggers don't count.
+ALTER EVENT TRIGGER relalter_full DISABLE;
+ALTER TABLE foo4 RENAME TO foo5;
+
+-- pg_dump writes the options out as the trigger's tags, and a trigger
+-- recreated from its dumped form has the same options.
+SELECT evttags FROM pg_event_trigger WHERE evtname = 'relalter_light';
+SELECT format('CREATE EVENT TRIGGER %I ON %I WHEN TAG IN (%s) EXECUTE PROCEDURE %s()',
+		evtname, evtevent,
+		array_to_string(array(SELECT quote_literal(x) FROM unnest(evttags) AS t(x)), ', '),
+		evtfoid::regproc) AS dumped
+	FROM pg_event_trigger WHERE evtname = 'relalter_light' \gset
+\echo :dumped
+DROP EVENT TRIGGER relalter_light;
+:dumped;
+SELECT evttags FROM pg_event_trigger WHERE evtname = 'relalter_light';
+ALTER TABLE foo5 RENAME TO foo6;
+
+-- Exercise the various cases that shouldn't work.
+CREATE EVENT TRIGGER wont_work ON relation_alter
+	WHEN capture IN ('everything')
+	EXECUTE PROCEDURE on_relation_alter();
+CREATE EVENT TRIGGER wont_work ON relation_alter
+	WHEN capture IN ('oid', 'full')
+	EXECUTE PROCEDURE on_relation_alter();
+CREATE EVENT TRIGGER wont_work ON relation_alter
+	WHEN capture IN ('oid') AND capture IN ('full')
+	EXECUTE PROCEDURE on_relation_alter();
+CREATE EVENT TRIGGER wont_work ON relation_alter
+	WHEN TAG IN ('capture')
+	EXECUTE PROCEDURE on_relation_alter();
+CREATE EVENT TRIGGER wont_work ON relation_alter
+	WHEN TAG IN ('capture=oid') AND capture IN ('full')
+	EXECUTE PROCEDURE on_relation_alter();
+
+-- Clean up.
+DROP EVENT TRIGGER relalter_oid;
+DROP EVENT TRIGGER relalter_light;
+DROP EVENT TRIGGER relalter_full;
+DROP FUNCTION on_relation_alter();
+DROP TABLE foo6;
+DROP EXTENSION schema_triggers;
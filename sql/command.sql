@@ -0,0 +1,44 @@
+CREATE EXTENSION schema_triggers;
+
+-- Report the command behind each event.
+CREATE FUNCTION on_event()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		command SCHEMA_TRIGGERS.COMMAND_INFO;
+	BEGIN
+		command := schema_triggers.get_current_command();
+		RAISE NOTICE '%: tg_tag=%, command_tag=%, query=%',
+			tg_event, tg_tag, command.command_tag, command.query;
+	END;
+$$;
+CREATE EVENT TRIGGER relalter ON relation_alter
+	EXECUTE PROCEDURE on_event();
+CREATE EVENT TRIGGER coladd ON column_add
+	EXECUTE PROCEDURE on_event();
+CREATE EVENT TRIGGER relcreate ON relation_create
+	EXECUTE PROCEDURE on_event();
+
+CREATE TABLE foo(a INTEGER);
+ALTER TABLE foo ADD COLUMN b TEXT;
+ALTER TABLE foo RENAME TO bar;
+CREATE INDEX bar_a_idx ON bar(a);
+
+-- Commands run from a function are reported on their own.
+DO $$
+BEGIN
+	EXECUTE 'ALTER TABLE bar RENAME TO baz';
+END;
+$$;
+
+-- The command is only available from an event trigger.
+SELECT schema_triggers.get_current_command();
+
+-- Clean up.
+DROP EVENT TRIGGER relalter;
+DROP EVENT TRIGGER coladd;
+DROP EVENT TRIGGER relcreate;
+DROP FUNCTION on_event();
+DROP TABLE baz;
+DROP EXTENSION schema_triggers;
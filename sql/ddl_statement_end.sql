@@ -0,0 +1,53 @@
+CREATE EXTENSION schema_triggers;
+
+-- Show what each DDL statement took.
+CREATE FUNCTION on_statement_end()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		info schema_triggers.ddl_statement_end_eventinfo;
+	BEGIN
+		info := schema_triggers.get_ddl_statement_end_eventinfo();
+		RAISE NOTICE '%: events=%, stmt_index=%, wrote catalogs: %, elapsed covers lock_wait: %',
+			tg_tag, info.events, info.stmt_index, info.catalog_rows > 0,
+			info.elapsed >= info.lock_wait;
+		RAISE NOTICE '  lock_wait=%, lock_relation=%, lock_mode=%',
+			info.lock_wait, info.lock_relation, info.lock_mode;
+	END;
+$$;
+CREATE FUNCTION on_event()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		RAISE NOTICE '% fired', tg_event;
+	END;
+$$;
+CREATE EVENT TRIGGER coladd ON column_add
+	EXECUTE PROCEDURE on_event();
+CREATE EVENT TRIGGER stmtend ON ddl_statement_end
+	EXECUTE PROCEDURE on_statement_end();
+
+-- The event fires after the statement's other events.
+CREATE TABLE stmtend1 (a INTEGER);
+ALTER TABLE stmtend1 ADD COLUMN b INTEGER, ADD COLUMN c INTEGER;
+COMMENT ON TABLE stmtend1 IS 'measured';
+
+-- Utility statements which aren't DDL don't raise it.
+VACUUM stmtend1;
+SET schema_triggers.lock_sample_interval = 5;
+RESET schema_triggers.lock_sample_interval;
+
+-- A dry run shows the trigger it would fire.
+SELECT event, events, triggers, trigger_calls
+	FROM schema_triggers.explain('DROP TABLE stmtend1')
+	ORDER BY event;
+DROP TABLE stmtend1;
+
+-- Clean up.
+DROP EVENT TRIGGER stmtend;
+DROP EVENT TRIGGER coladd;
+DROP FUNCTION on_statement_end();
+DROP FUNCTION on_event();
+DROP EXTENSION schema_triggers;
@@ -0,0 +1,39 @@
+CREATE EXTENSION schema_triggers;
+
+-- Show parts of the JSONB document for column_add and column_alter events.
+CREATE FUNCTION on_column_event()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		doc JSONB;
+	BEGIN
+		doc := schema_triggers.get_current_event_jsonb();
+		RAISE NOTICE '%(%, %): old.attname=%, new.attname=%',
+			doc->>'event', (doc->>'relation')::OID::REGCLASS, doc->'attnum',
+			doc->'old'->>'attname', doc->'new'->>'attname';
+		RAISE NOTICE '  has seqno: %, has new.attnotnull: %, has new.attislocal: %',
+			doc ? 'seqno', doc->'new' ? 'attnotnull', doc->'new' ? 'attislocal';
+		RAISE NOTICE '  same document on second call: %',
+			doc = schema_triggers.get_current_event_jsonb();
+	END;
+$$;
+CREATE EVENT TRIGGER coladd ON column_add
+	EXECUTE PROCEDURE on_column_event();
+CREATE EVENT TRIGGER colalter ON column_alter
+	EXECUTE PROCEDURE on_column_event();
+
+-- Default-valued fields (false, zero, NULL) are left out of the document.
+CREATE TABLE foo(a INTEGER);
+ALTER TABLE foo ADD COLUMN b TEXT NOT NULL;
+ALTER TABLE foo ALTER COLUMN b DROP NOT NULL;
+
+-- Outside of an event trigger, there is no current event.
+SELECT schema_triggers.get_current_event_jsonb();
+
+-- Clean up.
+DROP EVENT TRIGGER coladd;
+DROP EVENT TRIGGER colalter;
+DROP FUNCTION on_column_event();
+DROP TABLE foo;
+DROP EXTENSION schema_triggers;
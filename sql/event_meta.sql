@@ -0,0 +1,45 @@
+CREATE EXTENSION schema_triggers;
+
+-- Record the metadata of each column_add and column_drop event.
+CREATE TABLE seen(event TEXT, relation REGCLASS, seqno BIGINT, xid XID, stmt_index INTEGER);
+CREATE FUNCTION on_column_event()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		event_info SCHEMA_TRIGGERS.COLUMN_ADD_EVENTINFO;
+	BEGIN
+		INSERT INTO seen SELECT * FROM schema_triggers.get_current_event_meta();
+		IF TG_EVENT = 'column_add' THEN
+			event_info := schema_triggers.get_column_add_eventinfo();
+			RAISE NOTICE 'column_add(%, %): stmt_index=%', event_info.relation,
+				event_info.attnum, event_info.stmt_index;
+		END IF;
+	END;
+$$;
+CREATE EVENT TRIGGER coladd ON column_add
+	EXECUTE PROCEDURE on_column_event();
+CREATE EVENT TRIGGER coldrop ON column_drop
+	EXECUTE PROCEDURE on_column_event();
+
+CREATE TABLE foo(a INTEGER);
+ALTER TABLE foo ADD COLUMN b INTEGER, ADD COLUMN c INTEGER;
+BEGIN;
+ALTER TABLE foo DROP COLUMN b;
+ALTER TABLE foo DROP COLUMN c;
+COMMIT;
+
+-- Sequence numbers increase, and events in one transaction share an xid.
+SELECT event, relation, stmt_index,
+	seqno > lag(seqno) OVER (ORDER BY seqno) AS increasing,
+	xid = lag(xid) OVER (ORDER BY seqno) AS same_xid
+	FROM seen
+	ORDER BY seqno;
+
+-- Clean up.
+DROP EVENT TRIGGER coladd;
+DROP EVENT TRIGGER coldrop;
+DROP FUNCTION on_column_event();
+DROP TABLE foo;
+DROP TABLE seen;
+DROP EXTENSION schema_triggers;
@@ -16,7 +16,7 @@ CREATE FUNCTION raise_notice()
  AS $$ BEGIN RAISE NOTICE 'do_notice:  event=(%)', TG_EVENT; END; $$
  LANGUAGE plpgsql;
 
--- Ensure that we're not allowed to specify a WHEN clause.
+-- Ensure that command tags can't be given in the WHEN clause.
 CREATE EVENT TRIGGER cannot_have_when_clause ON relation_create
 	WHEN tag IN ('foo')
 	EXECUTE PROCEDURE raise_notice();
@@ -0,0 +1,54 @@
+CREATE EXTENSION schema_triggers;
+
+-- Triggers which show whether they were run.
+CREATE FUNCTION on_event()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		RAISE NOTICE '% fired', tg_event;
+	END;
+$$;
+CREATE EVENT TRIGGER relcreate ON relation_create
+	EXECUTE PROCEDURE on_event();
+CREATE EVENT TRIGGER coladd_a ON column_add
+	EXECUTE PROCEDURE on_event();
+CREATE EVENT TRIGGER coladd_b ON column_add
+	WHEN capture IN ('oid')
+	EXECUTE PROCEDURE on_event();
+CREATE TABLE explain1 (a INTEGER);
+
+-- The events and triggers are reported, but the triggers are not run, and
+-- the new columns are not kept.
+SELECT event, events, triggers, trigger_calls, queue_bytes > 0 AS queued
+	FROM schema_triggers.explain('ALTER TABLE explain1 ADD COLUMN b INTEGER, ADD COLUMN c INTEGER')
+	WHERE event = 'column_add';
+SELECT attname FROM pg_attribute
+	WHERE attrelid = 'explain1'::REGCLASS AND attnum > 0
+	ORDER BY attnum;
+
+-- Several statements, in a transaction which goes on afterwards.
+BEGIN;
+SELECT event, events, triggers, trigger_calls
+	FROM schema_triggers.explain('CREATE TABLE explain2 (a INTEGER); CREATE TABLE explain3 (a INTEGER)')
+	WHERE event IN ('relation_create', 'relation_create_complete')
+	ORDER BY event;
+SELECT count(*) FROM pg_class WHERE relname IN ('explain2', 'explain3');
+COMMIT;
+
+-- An error raised by the DDL is raised again, once it has been rolled back.
+\set VERBOSITY terse
+SELECT * FROM schema_triggers.explain('ALTER TABLE no_such_table ADD COLUMN a INTEGER');
+\set VERBOSITY default
+SELECT schema_triggers.event_context_count();
+
+-- The triggers are run as usual afterwards.
+ALTER TABLE explain1 ADD COLUMN b INTEGER;
+
+-- Clean up.
+DROP TABLE explain1;
+DROP EVENT TRIGGER relcreate;
+DROP EVENT TRIGGER coladd_a;
+DROP EVENT TRIGGER coladd_b;
+DROP FUNCTION on_event();
+DROP EXTENSION schema_triggers;
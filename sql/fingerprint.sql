@@ -0,0 +1,44 @@
+CREATE EXTENSION schema_triggers;
+
+-- Tables with the same columns have the same fingerprint.
+CREATE TABLE foo(a INTEGER NOT NULL, b TEXT);
+CREATE TABLE bar(b TEXT, a INTEGER NOT NULL);
+CREATE TABLE baz(a INTEGER, b TEXT);
+SELECT schema_triggers.relation_fingerprint('foo') = schema_triggers.relation_fingerprint('bar') AS foo_is_bar,
+	schema_triggers.relation_fingerprint('foo') = schema_triggers.relation_fingerprint('baz') AS foo_is_baz;
+
+-- The fingerprint is updated incrementally as columns are added, altered and
+-- dropped, and always agrees with a full recomputation.
+ALTER TABLE foo ADD COLUMN c VARCHAR(10);
+ALTER TABLE foo ALTER COLUMN c TYPE VARCHAR(20);
+ALTER TABLE foo ALTER COLUMN b SET NOT NULL;
+ALTER TABLE foo RENAME COLUMN a TO aaa;
+ALTER TABLE foo DROP COLUMN c;
+SELECT schema_triggers.relation_fingerprint('foo') = schema_triggers.relation_fingerprint_recompute('foo') AS matches;
+
+-- Columns added and altered together in one statement are counted correctly.
+ALTER TABLE foo ADD COLUMN d INTEGER, ALTER COLUMN d SET NOT NULL, ADD COLUMN e TEXT;
+SELECT schema_triggers.relation_fingerprint('foo') = schema_triggers.relation_fingerprint_recompute('foo') AS matches;
+ALTER TABLE foo DROP COLUMN d, DROP COLUMN e;
+
+-- Undoing the changes restores the original fingerprint.
+ALTER TABLE foo RENAME COLUMN aaa TO a;
+ALTER TABLE foo ALTER COLUMN b DROP NOT NULL;
+SELECT schema_triggers.relation_fingerprint('foo') = schema_triggers.relation_fingerprint('bar') AS foo_is_bar;
+
+-- The view reports the same fingerprints.
+SELECT relation, fingerprint = schema_triggers.relation_fingerprint_recompute(relation) AS matches
+	FROM schema_triggers.relation_fingerprints
+	WHERE relation IN ('foo'::REGCLASS, 'bar'::REGCLASS, 'baz'::REGCLASS)
+	ORDER BY relation::TEXT;
+
+-- It only lists relations in user schemas, and isn't readable by everyone.
+SELECT count(*) FROM schema_triggers.relation_fingerprints
+	WHERE relation IN ('pg_class'::REGCLASS, 'information_schema.tables'::REGCLASS);
+SELECT has_table_privilege('public', 'schema_triggers.relation_fingerprints', 'SELECT') AS public_can_read;
+
+-- Clean up.
+DROP TABLE foo;
+DROP TABLE bar;
+DROP TABLE baz;
+DROP EXTENSION schema_triggers;
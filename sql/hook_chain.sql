@@ -0,0 +1,73 @@
+-- Test that the extension's hooks chain with those of other modules, here
+-- pg_stat_statements.  Both libraries must be in shared_preload_libraries,
+-- so the test is run by "make hookcheck", in an instance of its own.
+
+CREATE EXTENSION schema_triggers;
+CREATE EXTENSION pg_stat_statements;
+
+CREATE FUNCTION on_relation_create()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		RAISE NOTICE 'on_relation_create: "%"',
+			(schema_triggers.get_relation_create_eventinfo()).relation;
+	END;
+$$;
+CREATE EVENT TRIGGER relcreate ON relation_create
+	EXECUTE PROCEDURE on_relation_create();
+
+CREATE FUNCTION on_relation_drop()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		RAISE NOTICE 'on_relation_drop: "%"',
+			((schema_triggers.get_relation_drop_eventinfo()).old).relname;
+	END;
+$$;
+CREATE EVENT TRIGGER reldrop ON relation_drop
+	EXECUTE PROCEDURE on_relation_drop();
+
+-- The event triggers fire, and pg_stat_statements counts the statements.
+SELECT pg_stat_statements_reset();
+CREATE TABLE hook_chain1 (a INTEGER);
+CREATE TABLE hook_chain2 (a INTEGER);
+DROP TABLE hook_chain1;
+DROP TABLE hook_chain2;
+CREATE TABLE hook_chain1 (a INTEGER);
+DROP TABLE hook_chain1;
+SELECT rtrim(query, ';') AS query, calls
+	FROM pg_stat_statements
+	WHERE query LIKE '% TABLE hook_chain%'
+	ORDER BY 1;
+
+-- A CREATE EVENT TRIGGER for one of the extension's own events is carried out
+-- without calling the previous hooks, so pg_stat_statements doesn't count it;
+-- one for a server event is passed on as usual.
+CREATE FUNCTION noop()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+	END;
+$$;
+SELECT pg_stat_statements_reset();
+CREATE EVENT TRIGGER relcreate_noop ON relation_create
+	EXECUTE PROCEDURE noop();
+CREATE EVENT TRIGGER ddlstart_noop ON ddl_command_start
+	EXECUTE PROCEDURE noop();
+SELECT substring(query from 'ON ([a-z_]+)') AS event, calls
+	FROM pg_stat_statements
+	WHERE query LIKE 'CREATE EVENT TRIGGER%'
+	ORDER BY 1;
+DROP EVENT TRIGGER ddlstart_noop;
+DROP EVENT TRIGGER relcreate_noop;
+DROP FUNCTION noop();
+
+DROP EVENT TRIGGER relcreate;
+DROP EVENT TRIGGER reldrop;
+DROP FUNCTION on_relation_create();
+DROP FUNCTION on_relation_drop();
+DROP EXTENSION pg_stat_statements;
+DROP EXTENSION schema_triggers;
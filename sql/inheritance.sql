@@ -0,0 +1,80 @@
+CREATE EXTENSION schema_triggers;
+
+-- Report the column events, and the children collapsed into them.
+CREATE FUNCTION on_column_add()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		event_info SCHEMA_TRIGGERS.COLUMN_ADD_EVENTINFO;
+	BEGIN
+		event_info := schema_triggers.get_column_add_eventinfo();
+		RAISE NOTICE 'on_column_add(%, %): children=%',
+			event_info.relation, (event_info.new).attname, event_info.children;
+	END;
+$$;
+CREATE FUNCTION on_column_drop()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		event_info SCHEMA_TRIGGERS.COLUMN_DROP_EVENTINFO;
+	BEGIN
+		event_info := schema_triggers.get_column_drop_eventinfo();
+		RAISE NOTICE 'on_column_drop(%, %): children=%',
+			event_info.relation, (event_info.old).attname, event_info.children;
+	END;
+$$;
+CREATE TABLE parent(a INTEGER);
+CREATE TABLE child1() INHERITS (parent);
+CREATE TABLE child2() INHERITS (parent);
+CREATE TABLE grandchild() INHERITS (child1);
+
+-- By default, every relation the command recurses to gets its own event.
+CREATE EVENT TRIGGER coladd ON column_add
+	EXECUTE PROCEDURE on_column_add();
+CREATE EVENT TRIGGER coldrop ON column_drop
+	EXECUTE PROCEDURE on_column_drop();
+ALTER TABLE parent ADD COLUMN b TEXT;
+ALTER TABLE parent DROP COLUMN b;
+
+-- With children=collapse, the parent's event lists the children instead.
+-- The children's events are raised after the parent's when adding a column,
+-- and before it when dropping one.
+DROP EVENT TRIGGER coladd;
+DROP EVENT TRIGGER coldrop;
+CREATE EVENT TRIGGER coladd ON column_add
+	WHEN children IN ('collapse')
+	EXECUTE PROCEDURE on_column_add();
+CREATE EVENT TRIGGER coldrop ON column_drop
+	WHEN children IN ('collapse')
+	EXECUTE PROCEDURE on_column_drop();
+ALTER TABLE parent ADD COLUMN c TEXT, ADD COLUMN d INTEGER;
+ALTER TABLE parent DROP COLUMN c, DROP COLUMN d;
+
+-- A command on a child collapses only that child's own descendants.
+ALTER TABLE child1 ADD COLUMN e TEXT;
+
+-- Every trigger on the event must ask for its children to be collapsed.
+CREATE EVENT TRIGGER coladd_each ON column_add
+	WHEN children IN ('each')
+	EXECUTE PROCEDURE on_column_add();
+ALTER TABLE parent ADD COLUMN f TEXT;
+DROP EVENT TRIGGER coladd_each;
+
+-- The collapsed children's fingerprints are still right.
+SELECT relation, schema_triggers.relation_fingerprint(relation) = schema_triggers.relation_fingerprint_recompute(relation) AS matches
+	FROM unnest('{parent,child1,child2,grandchild}'::REGCLASS[]) AS relation;
+
+-- An invalid value for the option.
+CREATE EVENT TRIGGER wont_work ON column_add
+	WHEN children IN ('some')
+	EXECUTE PROCEDURE on_column_add();
+
+-- Clean up.
+DROP EVENT TRIGGER coladd;
+DROP EVENT TRIGGER coldrop;
+DROP FUNCTION on_column_add();
+DROP FUNCTION on_column_drop();
+DROP TABLE grandchild, child1, child2, parent;
+DROP EXTENSION schema_triggers;
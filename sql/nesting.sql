@@ -0,0 +1,51 @@
+CREATE EXTENSION schema_triggers;
+\set VERBOSITY terse
+
+-- An event trigger which runs DDL of its own, firing itself again.
+CREATE FUNCTION on_relation_create()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		event_info SCHEMA_TRIGGERS.RELATION_CREATE_EVENTINFO;
+	BEGIN
+		event_info := schema_triggers.get_relation_create_eventinfo();
+		RAISE NOTICE 'on_relation_create(%)', event_info.relation;
+		IF (event_info.new).relname LIKE 'auto%' THEN
+			EXECUTE format('CREATE VIEW %I AS SELECT 1 AS one',
+						   (event_info.new).relname || '_v');
+		END IF;
+	END;
+$$;
+CREATE EVENT TRIGGER relcreate ON relation_create
+	EXECUTE PROCEDURE on_relation_create();
+
+-- The nesting stops at schema_triggers.max_nesting_depth.
+SET schema_triggers.max_nesting_depth = 2;
+CREATE TABLE auto();
+SELECT relname FROM pg_class WHERE relname LIKE 'auto%' ORDER BY relname;
+
+-- A trigger can ask not to be fired for statements run by event triggers.
+DROP EVENT TRIGGER relcreate;
+CREATE EVENT TRIGGER relcreate ON relation_create
+	WHEN nested IN ('skip')
+	EXECUTE PROCEDURE on_relation_create();
+CREATE TABLE auto();
+SELECT relname FROM pg_class WHERE relname LIKE 'auto%' ORDER BY relname;
+DROP VIEW auto_v;
+DROP TABLE auto;
+
+-- A limit of zero keeps event triggers from running DDL at all.
+SET schema_triggers.max_nesting_depth = 0;
+CREATE TABLE auto();
+RESET schema_triggers.max_nesting_depth;
+
+-- An invalid value for the option.
+CREATE EVENT TRIGGER wont_work ON relation_create
+	WHEN nested IN ('sometimes')
+	EXECUTE PROCEDURE on_relation_create();
+
+-- Clean up.
+DROP EVENT TRIGGER relcreate;
+DROP FUNCTION on_relation_create();
+DROP EXTENSION schema_triggers;
@@ -0,0 +1,93 @@
+CREATE EXTENSION schema_triggers;
+
+-- Malformed channel lists are rejected.
+SET schema_triggers.notify_channels = 'column_add';
+SET schema_triggers.notify_channels = '=ddl';
+SET schema_triggers.notify_channels = 'column_add=';
+SET schema_triggers.notify_channels = 'column_add = ddl';
+
+-- psql writes the notifications it receives to the \o file, from which they
+-- are read back without the PID of the backend which sent them.
+CREATE TEMP TABLE notifications (n SERIAL, line TEXT);
+CREATE TEMP VIEW notified AS
+	SELECT n, m[1] AS channel, m[2]::JSON AS payload
+	FROM (SELECT n, regexp_matches(line, '^Asynchronous notification "(.*)" with payload "(.*)" received from server process with PID [0-9]+\.$') AS m
+		FROM notifications) AS lines;
+LISTEN ddl;
+LISTEN ddl_other;
+
+-- Publish column_add events to one channel, and every other event to another.
+-- The columns are both added to the same relation, so it is published once,
+-- and nothing is published by a transaction which rolls back.
+CREATE TABLE notify1 (a INTEGER);
+SET schema_triggers.notify_channels = 'column_add=ddl, *=ddl_other';
+\o results/notify.log
+ALTER TABLE notify1 ADD COLUMN b INTEGER, ADD COLUMN c INTEGER;
+CREATE TABLE notify2 (a INTEGER);
+BEGIN;
+ALTER TABLE notify2 ADD COLUMN b INTEGER;
+ROLLBACK;
+\o
+\copy notifications (line) FROM 'results/notify.log'
+SELECT n, channel, event, relation::TEXT::OID::REGCLASS
+	FROM notified, json_each(payload) AS e(event, relations),
+		json_array_elements(relations) AS r(relation)
+	ORDER BY n, event, relation::TEXT;
+
+-- Relations whose events are collapsed into their parent's are published too.
+RESET schema_triggers.notify_channels;
+CREATE TABLE notify_child () INHERITS (notify1);
+CREATE FUNCTION on_column_add()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+	END;
+$$;
+CREATE EVENT TRIGGER coladd ON column_add
+	WHEN children IN ('collapse')
+	EXECUTE PROCEDURE on_column_add();
+SET schema_triggers.notify_channels = 'column_add=ddl';
+TRUNCATE notifications RESTART IDENTITY;
+\o results/notify.log
+ALTER TABLE notify1 ADD COLUMN d INTEGER;
+\o
+\copy notifications (line) FROM 'results/notify.log'
+SELECT n, channel, event, relation::TEXT::OID::REGCLASS
+	FROM notified, json_each(payload) AS e(event, relations),
+		json_array_elements(relations) AS r(relation)
+	ORDER BY n, event, relation::TEXT;
+DROP EVENT TRIGGER coladd;
+DROP FUNCTION on_column_add();
+
+-- A statement's events are split over as many notifications as the payload
+-- size limit requires.
+RESET schema_triggers.notify_channels;
+CREATE SCHEMA notify_many;
+DO $$
+	BEGIN
+		FOR i IN 1..2000 LOOP
+			EXECUTE format('CREATE TABLE notify_many.t%s ()', i);
+		END LOOP;
+	END;
+$$;
+SET schema_triggers.notify_channels = 'relation_drop=ddl';
+SET client_min_messages = warning;
+TRUNCATE notifications;
+\o results/notify.log
+DROP SCHEMA notify_many CASCADE;
+\o
+RESET client_min_messages;
+\copy notifications (line) FROM 'results/notify.log'
+SELECT count(*) > 1 AS split,
+	sum(json_array_length(payload->'relation_drop')) AS relations,
+	max(octet_length(payload::TEXT)) < 8000 AS fits
+	FROM notified;
+
+-- Clean up.
+RESET schema_triggers.notify_channels;
+UNLISTEN *;
+DROP TABLE notify_child, notify1, notify2;
+DROP VIEW notified;
+DROP TABLE notifications;
+DROP EXTENSION schema_triggers;
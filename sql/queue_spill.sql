@@ -0,0 +1,50 @@
+CREATE EXTENSION schema_triggers;
+
+-- Log each column_add event.
+CREATE TABLE seen(id SERIAL, attnum INT2, attname NAME, stmt_index INTEGER);
+CREATE FUNCTION on_column_add()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		event_info SCHEMA_TRIGGERS.COLUMN_ADD_EVENTINFO;
+	BEGIN
+		event_info := schema_triggers.get_column_add_eventinfo();
+		INSERT INTO seen(attnum, attname, stmt_index)
+			VALUES (event_info.attnum, (event_info.new).attname, event_info.stmt_index);
+	END;
+$$;
+CREATE EVENT TRIGGER coladd ON column_add
+	EXECUTE PROCEDURE on_column_add();
+
+-- Add enough columns in one statement for the queued events to be spilled
+-- to disk.  They should all come back, whole and in order.
+SET schema_triggers.queue_mem = 64;
+CREATE TABLE wide();
+DO $$
+BEGIN
+	EXECUTE 'ALTER TABLE wide ' ||
+		(SELECT string_agg(format('ADD COLUMN c%s INTEGER', i), ', ')
+		 FROM generate_series(1, 1000) i);
+END;
+$$;
+SELECT count(*),
+	bool_and(attnum = id) AS attnum_ok,
+	bool_and(attname = 'c' || id) AS attname_ok,
+	bool_and(stmt_index > prev_index) AS stmt_index_ok
+FROM (SELECT *, lag(stmt_index, 1, 0) OVER (ORDER BY id) AS prev_index FROM seen) s;
+
+-- A statement that fits in memory behaves the same.
+RESET schema_triggers.queue_mem;
+TRUNCATE seen;
+ALTER SEQUENCE seen_id_seq RESTART;
+CREATE TABLE narrow();
+ALTER TABLE narrow ADD COLUMN c1 INTEGER, ADD COLUMN c2 INTEGER;
+SELECT id, attnum, attname FROM seen ORDER BY id;
+
+
+-- Clean up.
+DROP EVENT TRIGGER coladd;
+DROP FUNCTION on_column_add();
+DROP TABLE seen, wide, narrow;
+DROP EXTENSION schema_triggers;
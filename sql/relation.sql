@@ -13,6 +13,9 @@ CREATE FUNCTION on_relation_create()
 		RAISE NOTICE '  (relnamespace=%, relkind=''%'', relnatts=%, relhaspkey=''%'')',
 			(event_info.new).relnamespace, (event_info.new).relkind,
 			(event_info.new).relnatts, (event_info.new).relhaspkey;
+		RAISE NOTICE '  (columns=%)',
+			(SELECT string_agg(attname || ' ' || format_type(atttypid, atttypmod), ', ' ORDER BY attnum)
+			 FROM unnest(event_info.columns));
 		IF (event_info.new).relname LIKE 'test_%' THEN
 			RAISE EXCEPTION 'relation name cannot begin with "test_"';
 		END IF;
@@ -0,0 +1,48 @@
+CREATE EXTENSION schema_triggers;
+
+-- Report the final state of each new relation.
+CREATE FUNCTION on_relation_create_complete()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		event_info SCHEMA_TRIGGERS.RELATION_CREATE_COMPLETE_EVENTINFO;
+	BEGIN
+		event_info := schema_triggers.get_relation_create_complete_eventinfo();
+		RAISE NOTICE 'on_relation_create_complete: "%" (relkind=''%'', relhaspkey=''%'')',
+			event_info.relation, (event_info.new).relkind, (event_info.new).relhaspkey;
+		RAISE NOTICE '  columns: %',
+			(SELECT string_agg(attname::TEXT, ', ' ORDER BY attnum)
+			 FROM unnest(event_info.columns));
+		RAISE NOTICE '  defaults: %',
+			(SELECT string_agg(adnum || '=' || pg_get_expr(adbin, adrelid), ', ' ORDER BY adnum)
+			 FROM unnest(event_info.defaults));
+		RAISE NOTICE '  constraints: %',
+			(SELECT string_agg(conname || ' ' || contype, ', ' ORDER BY conname)
+			 FROM unnest(event_info.constraints));
+		RAISE NOTICE '  indexes: %',
+			(SELECT string_agg(indexrelid::REGCLASS::TEXT, ', ' ORDER BY indexrelid::REGCLASS::TEXT)
+			 FROM unnest(event_info.indexes));
+	END;
+$$;
+CREATE EVENT TRIGGER relcreatecomplete ON relation_create_complete
+	EXECUTE PROCEDURE on_relation_create_complete();
+
+-- The event fires once the whole statement is done, so the table's defaults,
+-- constraints and indexes are all there;  its indexes get their own events.
+CREATE TABLE foo(
+	id INTEGER PRIMARY KEY,
+	name TEXT NOT NULL DEFAULT 'none',
+	qty INTEGER DEFAULT 1 CHECK (qty > 0),
+	UNIQUE (name)
+);
+
+-- Later changes to the table don't raise the event again, but a new index does.
+ALTER TABLE foo ADD COLUMN note TEXT;
+CREATE INDEX foo_qty_idx ON foo(qty);
+
+-- Clean up.
+DROP EVENT TRIGGER relcreatecomplete;
+DROP FUNCTION on_relation_create_complete();
+DROP TABLE foo;
+DROP EXTENSION schema_triggers;
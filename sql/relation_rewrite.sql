@@ -0,0 +1,74 @@
+CREATE EXTENSION schema_triggers;
+
+-- Refuse to rewrite relations of more than 100 pages.
+CREATE FUNCTION on_relation_rewrite()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		info schema_triggers.relation_rewrite_eventinfo;
+	BEGIN
+		info := schema_triggers.get_relation_rewrite_eventinfo();
+		RAISE NOTICE 'relation_rewrite(%): relpages=%, reltuples=%, reason=%, reasons=%',
+			info.relation, info.relpages, info.reltuples, info.reason, info.reasons;
+		RAISE NOTICE '  new.relname=%, size covers relpages: %',
+			(info.new).relname, info.size >= info.relpages * 8192;
+		IF info.size > 100 * 8192 THEN
+			RAISE EXCEPTION 'rewrite of % refused', info.relation
+				USING HINT = 'Run it in the maintenance window.';
+		END IF;
+	END;
+$$;
+CREATE EVENT TRIGGER relrewrite ON relation_rewrite
+	EXECUTE PROCEDURE on_relation_rewrite();
+
+-- A column type change fires the event before the rewrite, and before the
+-- statement's queued events.
+CREATE FUNCTION on_event()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		RAISE NOTICE '% fired', tg_event;
+	END;
+$$;
+CREATE EVENT TRIGGER colalter ON column_alter
+	EXECUTE PROCEDURE on_event();
+CREATE TABLE small (a INTEGER);
+INSERT INTO small SELECT generate_series(1, 10);
+ANALYZE small;
+ALTER TABLE small ALTER COLUMN a TYPE BIGINT;
+ANALYZE small;
+ALTER TABLE small SET UNLOGGED;
+
+-- Changes which don't rewrite the relation don't raise the event.
+ALTER TABLE small ADD COLUMN b INTEGER;
+ALTER TABLE small ALTER COLUMN a TYPE BIGINT;
+
+-- A large relation is left as it was.
+CREATE TABLE big (a INTEGER);
+INSERT INTO big SELECT generate_series(1, 50000);
+ANALYZE big;
+\set VERBOSITY terse
+ALTER TABLE big ALTER COLUMN a TYPE BIGINT;
+\set VERBOSITY default
+SELECT atttypid::REGTYPE FROM pg_attribute WHERE attrelid = 'big'::REGCLASS AND attname = 'a';
+SELECT schema_triggers.event_context_count();
+
+-- A dry run shows the trigger which would guard the rewrite, without it
+-- being run.
+SELECT event, events, triggers, trigger_calls
+	FROM schema_triggers.explain('ALTER TABLE big ALTER COLUMN a TYPE BIGINT')
+	WHERE event = 'relation_rewrite';
+
+-- Once the trigger is gone, the rewrite goes ahead.
+DROP EVENT TRIGGER relrewrite;
+ALTER TABLE big ALTER COLUMN a TYPE BIGINT;
+
+-- Clean up.
+DROP TABLE small;
+DROP TABLE big;
+DROP EVENT TRIGGER colalter;
+DROP FUNCTION on_relation_rewrite();
+DROP FUNCTION on_event();
+DROP EXTENSION schema_triggers;
@@ -0,0 +1,51 @@
+CREATE EXTENSION schema_triggers;
+
+-- Create some tables and remember their current schema versions.
+CREATE TABLE foo(a INTEGER);
+CREATE TABLE bar(a INTEGER);
+CREATE TEMP TABLE versions AS
+	SELECT schema_triggers.relation_version('foo') AS foo,
+		schema_triggers.relation_version('bar') AS bar;
+
+-- Altering a table bumps its version, and only its version.
+ALTER TABLE foo ADD COLUMN b TEXT;
+SELECT schema_triggers.relation_version('foo') > foo AS foo_changed,
+	schema_triggers.relation_version('bar') = bar AS bar_unchanged
+	FROM versions;
+UPDATE versions SET foo = schema_triggers.relation_version('foo');
+
+-- The bulk variant agrees with the single-relation variant.
+SELECT schema_triggers.relation_version(ARRAY['foo', 'bar']::REGCLASS[]) = ARRAY[foo, bar]
+	AS bulk_matches
+	FROM versions;
+
+-- Changes are only counted once the transaction commits.
+BEGIN;
+ALTER TABLE bar ALTER COLUMN a SET NOT NULL;
+SELECT schema_triggers.relation_version('bar') = bar AS bar_unchanged FROM versions;
+COMMIT;
+SELECT schema_triggers.relation_version('bar') > bar AS bar_changed FROM versions;
+UPDATE versions SET bar = schema_triggers.relation_version('bar');
+
+-- Changes made by an aborted transaction or subtransaction are discarded.
+BEGIN;
+ALTER TABLE foo DROP COLUMN b;
+ROLLBACK;
+BEGIN;
+SAVEPOINT s;
+ALTER TABLE bar RENAME COLUMN a TO aaa;
+ROLLBACK TO SAVEPOINT s;
+COMMIT;
+SELECT schema_triggers.relation_version('foo') = foo AS foo_unchanged,
+	schema_triggers.relation_version('bar') = bar AS bar_unchanged
+	FROM versions;
+
+-- Dropping a relation doesn't take its version backwards.
+SELECT 'foo'::REGCLASS::OID AS foo_oid \gset
+DROP TABLE foo;
+SELECT schema_triggers.relation_version(:foo_oid) > foo AS foo_newer FROM versions;
+
+-- Clean up.
+DROP TABLE bar;
+DROP TABLE versions;
+DROP EXTENSION schema_triggers;
@@ -0,0 +1,90 @@
+CREATE EXTENSION schema_triggers;
+
+-- Report each event, with the catalog rows and command it was raised with.
+CREATE FUNCTION on_event()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		command SCHEMA_TRIGGERS.COMMAND_INFO;
+		detail TEXT;
+	BEGIN
+		command := schema_triggers.get_current_command();
+		IF tg_event = 'relation_create' THEN
+			detail := ((schema_triggers.get_relation_create_eventinfo()).new).relname;
+		ELSIF tg_event = 'column_add' THEN
+			detail := ((schema_triggers.get_column_add_eventinfo()).new).attname;
+		ELSE
+			detail := ((schema_triggers.get_relation_drop_eventinfo()).old).relname;
+		END IF;
+		RAISE NOTICE '%: %, tg_tag=%, query=%', tg_event, detail, tg_tag, command.query;
+	END;
+$$;
+CREATE EVENT TRIGGER relcreate ON relation_create
+	WHEN capture IN ('oid')
+	EXECUTE PROCEDURE on_event();
+CREATE EVENT TRIGGER coladd ON column_add
+	EXECUTE PROCEDURE on_event();
+CREATE EVENT TRIGGER reldrop ON relation_drop
+	EXECUTE PROCEDURE on_event();
+
+-- Record the events of a few statements to an empty file.  They are captured
+-- in full, whatever their triggers ask for.
+SELECT current_setting('data_directory') || '/schema_triggers_replay.rec' AS record_file \gset
+COPY (SELECT 1 WHERE false) TO :'record_file';
+SET schema_triggers.record_file = :'record_file';
+CREATE TABLE replay1 (a INTEGER);
+ALTER TABLE replay1 ADD COLUMN b INTEGER;
+DROP TABLE replay1;
+RESET schema_triggers.record_file;
+
+-- Replay them twice over;  the triggers see the recorded events.
+SELECT trigger, event, calls, total_time >= max_time AS timed
+	FROM schema_triggers.replay(:'record_file', 2)
+	ORDER BY trigger;
+
+-- Only the triggers which exist now are fired.
+DROP EVENT TRIGGER relcreate;
+SELECT trigger, event, calls
+	FROM schema_triggers.replay(:'record_file')
+	ORDER BY trigger;
+
+-- The relations collapsed into an event are recorded and replayed with it.
+DROP EVENT TRIGGER coladd;
+CREATE FUNCTION on_column_add()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	DECLARE
+		info SCHEMA_TRIGGERS.COLUMN_ADD_EVENTINFO;
+	BEGIN
+		info := schema_triggers.get_column_add_eventinfo();
+		RAISE NOTICE '%: %, children=%', tg_event, (info.new).attname, info.children;
+	END;
+$$;
+CREATE EVENT TRIGGER coladd ON column_add
+	WHEN children IN ('collapse')
+	EXECUTE PROCEDURE on_column_add();
+CREATE TABLE replay_parent (a INTEGER);
+CREATE TABLE replay_child () INHERITS (replay_parent);
+COPY (SELECT 1 WHERE false) TO :'record_file';
+SET schema_triggers.record_file = :'record_file';
+ALTER TABLE replay_parent ADD COLUMN b INTEGER;
+RESET schema_triggers.record_file;
+SELECT trigger, event, calls
+	FROM schema_triggers.replay(:'record_file')
+	ORDER BY trigger;
+
+-- Errors.
+SELECT * FROM schema_triggers.replay(:'record_file', 0);
+SELECT * FROM schema_triggers.replay('no_such_file');
+SELECT * FROM schema_triggers.replay('PG_VERSION');
+
+-- Clean up.
+COPY (SELECT 1 WHERE false) TO :'record_file';
+DROP EVENT TRIGGER coladd;
+DROP EVENT TRIGGER reldrop;
+DROP TABLE replay_child, replay_parent;
+DROP FUNCTION on_column_add();
+DROP FUNCTION on_event();
+DROP EXTENSION schema_triggers;
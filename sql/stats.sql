@@ -0,0 +1,38 @@
+CREATE EXTENSION schema_triggers;
+SELECT schema_triggers.pg_stat_schema_triggers_reset();
+
+-- An event trigger which looks at its event.
+CREATE FUNCTION on_column_add()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		PERFORM schema_triggers.get_column_add_eventinfo();
+	END;
+$$;
+CREATE EVENT TRIGGER coladd ON column_add
+	EXECUTE PROCEDURE on_column_add();
+
+-- Events without triggers are captured but skipped;  max_queued is the most
+-- events of a kind raised by a single statement.
+CREATE TABLE foo();
+ALTER TABLE foo ADD COLUMN a INTEGER, ADD COLUMN b INTEGER;
+ALTER TABLE foo ADD COLUMN c INTEGER;
+SELECT event, captured, fired, skipped, max_queued,
+		catalog_fetches > 0 AS fetched,
+		total_capture_time >= max_capture_time AS capture_ok,
+		total_dispatch_time >= max_dispatch_time AS dispatch_ok
+	FROM schema_triggers.pg_stat_schema_triggers
+	WHERE event IN ('relation_create', 'column_add')
+	ORDER BY event;
+
+-- Resetting discards the statistics of the events and of the triggers.
+SELECT schema_triggers.pg_stat_schema_triggers_reset();
+SELECT count(*) FROM schema_triggers.pg_stat_schema_triggers;
+SELECT count(*) FROM schema_triggers.event_trigger_stats;
+
+-- Clean up.
+DROP EVENT TRIGGER coladd;
+DROP FUNCTION on_column_add();
+DROP TABLE foo;
+DROP EXTENSION schema_triggers;
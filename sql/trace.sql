@@ -0,0 +1,39 @@
+CREATE EXTENSION schema_triggers;
+
+-- An event trigger to be timed.
+CREATE FUNCTION on_relation_create()
+ RETURNS event_trigger
+ LANGUAGE plpgsql
+ AS $$
+	BEGIN
+		PERFORM schema_triggers.get_relation_create_eventinfo();
+	END;
+$$;
+CREATE EVENT TRIGGER relcreate ON relation_create
+	EXECUTE PROCEDURE on_relation_create();
+
+-- Nothing is recorded until tracing is turned on.
+CREATE TABLE foo(a INTEGER);
+SELECT json_array_length(schema_triggers.dump_trace()->'traceEvents');
+
+-- Each kind of span is recorded, and all of them end.  (Which other hook
+-- calls are made varies between server versions.)
+SET schema_triggers.trace = on;
+CREATE TABLE bar(a INTEGER);
+RESET schema_triggers.trace;
+SELECT e->>'cat' AS cat, e->>'name' AS name, bool_and(e->>'ph' = 'X') AS ended
+	FROM json_array_elements(schema_triggers.dump_trace(false)->'traceEvents') e
+	WHERE e->>'cat' <> 'hook' OR e->>'name' = 'post_create'
+	GROUP BY 1, 2
+	ORDER BY 1, 2;
+
+-- Dumping the trace discards it, unless asked not to.
+SELECT json_array_length(schema_triggers.dump_trace()->'traceEvents') > 0 AS has_spans;
+SELECT json_array_length(schema_triggers.dump_trace()->'traceEvents');
+
+-- Clean up.
+DROP EVENT TRIGGER relcreate;
+DROP FUNCTION on_relation_create();
+DROP TABLE foo;
+DROP TABLE bar;
+DROP EXTENSION schema_triggers;
@@ -0,0 +1,22 @@
+CREATE EXTENSION schema_triggers;
+
+-- Remember the current generation.
+CREATE TABLE foo(a INTEGER);
+CREATE TEMP TABLE gen(generation BIGINT);
+INSERT INTO gen
+	SELECT generation FROM schema_triggers.wait_for_change(0, '0 seconds');
+
+-- Nothing has changed, so we wait until the timeout.
+SELECT w.generation = g.generation AS unchanged, w.relations
+	FROM gen g, LATERAL schema_triggers.wait_for_change(g.generation, '10 milliseconds') w;
+
+-- A committed change is returned straight away.
+ALTER TABLE foo ADD COLUMN b INTEGER;
+SELECT w.generation = g.generation + 1 AS one_commit,
+	w.relations = ARRAY['foo'::REGCLASS::OID] AS only_foo
+	FROM gen g, LATERAL schema_triggers.wait_for_change(g.generation, '1 minute') w;
+
+-- Clean up.
+DROP TABLE foo;
+DROP TABLE gen;
+DROP EXTENSION schema_triggers;
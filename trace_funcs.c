@@ -0,0 +1,222 @@
+/*
+ * A timeline of the event processing done by this session, for finding out
+ * where a slow statement's time went.  While schema_triggers.trace is on,
+ * each utility statement's setup, object access hook call, catalog scan,
+ * event firing and trigger call is recorded as a timed span in a
+ * backend-local buffer;  dump_trace() returns the spans as Chrome trace-event
+ * JSON, which chrome://tracing and Perfetto can display.
+ *
+ * Spans are recorded as they begin, so nested spans follow their parents.  A
+ * span which was ended by an error is dumped without an end, and spans past
+ * the first schema_triggers.trace_max_spans are dropped.
+ *
+ * pg_schema_triggers/trace_funcs.c
+ */
+
+
+#include "postgres.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "lib/stringinfo.h"
+#include "portability/instr_time.h"
+#include "utils/builtins.h"
+#include "utils/json.h"
+#include "utils/memutils.h"
+
+
+#include "trace_funcs.h"
+
+
+/* A span of the timeline. */
+typedef struct TraceSpan {
+	const char *name;				/* both must be string constants */
+	const char *category;
+	StringInfoData args;			/* the members of the span's "args" object */
+	instr_time start;				/* relative to trace_origin */
+	instr_time duration;
+	bool ended;
+} TraceSpan;
+
+
+bool trace_enabled = false;
+int trace_max_spans = 10000;
+
+static TraceSpan *trace_spans = NULL;
+static MemoryContext trace_mcontext = NULL;	/* holds the spans' args */
+static int trace_nspans = 0;
+static int trace_allocated = 0;
+static long trace_dropped = 0;
+static instr_time trace_origin;
+
+
+/*
+ * Begin a span of the timeline, with the numeric members of its "args" object
+ * given printf-style;  strings are added with trace_span_add_string(), which
+ * escapes them.  Returns the span's number for trace_span_end(), or -1 if the
+ * span is not being recorded.
+ */
+int
+trace_span_begin(const char *name, const char *category, const char *argfmt, ...)
+{
+	TraceSpan *span;
+	instr_time now;
+	MemoryContext old_mcontext;
+
+	if (!trace_enabled)
+		return -1;
+	if (trace_nspans >= trace_max_spans)
+	{
+		trace_dropped++;
+		return -1;
+	}
+
+	if (trace_nspans >= trace_allocated)
+	{
+		int newsize = Min(Max(trace_allocated * 2, 256), trace_max_spans);
+
+		if (trace_spans == NULL)
+		{
+			trace_spans = (TraceSpan *) MemoryContextAlloc(TopMemoryContext,
+														   newsize * sizeof(TraceSpan));
+			trace_mcontext = AllocSetContextCreate(TopMemoryContext,
+												   "schema_triggers trace",
+												   ALLOCSET_DEFAULT_MINSIZE,
+												   ALLOCSET_DEFAULT_INITSIZE,
+												   ALLOCSET_DEFAULT_MAXSIZE);
+		}
+		else
+			trace_spans = (TraceSpan *) repalloc(trace_spans, newsize * sizeof(TraceSpan));
+		trace_allocated = newsize;
+	}
+
+	INSTR_TIME_SET_CURRENT(now);
+	if (trace_nspans == 0)
+		trace_origin = now;
+
+	span = &trace_spans[trace_nspans];
+	span->name = name;
+	span->category = category;
+	old_mcontext = MemoryContextSwitchTo(trace_mcontext);
+	initStringInfo(&span->args);
+	for (;;)
+	{
+		va_list args;
+#if PG_VERSION_NUM >= 90500
+		int needed;
+
+		va_start(args, argfmt);
+		needed = appendStringInfoVA(&span->args, argfmt, args);
+		va_end(args);
+		if (needed == 0)
+			break;
+		enlargeStringInfo(&span->args, needed);
+#else
+		bool done;
+
+		va_start(args, argfmt);
+		done = appendStringInfoVA(&span->args, argfmt, args);
+		va_end(args);
+		if (done)
+			break;
+		enlargeStringInfo(&span->args, span->args.maxlen);
+#endif
+	}
+	MemoryContextSwitchTo(old_mcontext);
+	span->start = now;
+	INSTR_TIME_SUBTRACT(span->start, trace_origin);
+	INSTR_TIME_SET_ZERO(span->duration);
+	span->ended = false;
+	return trace_nspans++;
+}
+
+
+/*
+ * Add a string member to the "args" object of a span begun by
+ * trace_span_begin().
+ */
+void
+trace_span_add_string(int span, const char *key, const char *value)
+{
+	TraceSpan *item;
+	MemoryContext old_mcontext;
+
+	if (span < 0 || span >= trace_nspans)
+		return;
+
+	item = &trace_spans[span];
+	old_mcontext = MemoryContextSwitchTo(trace_mcontext);
+	if (item->args.len > 0)
+		appendStringInfoString(&item->args, ", ");
+	escape_json(&item->args, key);
+	appendStringInfoString(&item->args, ": ");
+	escape_json(&item->args, value != NULL ? value : "");
+	MemoryContextSwitchTo(old_mcontext);
+}
+
+
+/*
+ * End a span begun by trace_span_begin().
+ */
+void
+trace_span_end(int span)
+{
+	TraceSpan *item;
+	instr_time now;
+
+	if (span < 0 || span >= trace_nspans)
+		return;
+
+	item = &trace_spans[span];
+	INSTR_TIME_SET_CURRENT(now);
+	INSTR_TIME_SUBTRACT(now, trace_origin);
+	item->duration = now;
+	INSTR_TIME_SUBTRACT(item->duration, item->start);
+	item->ended = true;
+}
+
+
+/*
+ * SQL-callable function returning the recorded spans as a Chrome trace-event
+ * JSON document, and optionally discarding them.
+ */
+PG_FUNCTION_INFO_V1(dump_trace);
+Datum
+dump_trace(PG_FUNCTION_ARGS)
+{
+	bool reset = PG_GETARG_BOOL(0);
+	StringInfoData buf;
+	int i;
+
+	initStringInfo(&buf);
+	appendStringInfoString(&buf, "{\"traceEvents\": [");
+	for (i = 0; i < trace_nspans; i++)
+	{
+		TraceSpan *span = &trace_spans[i];
+
+		if (i > 0)
+			appendStringInfoChar(&buf, ',');
+		appendStringInfo(&buf,
+						 "\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%s\", "
+						 "\"pid\": %d, \"tid\": %d, \"ts\": %.3f",
+						 span->name, span->category, span->ended ? "X" : "B",
+						 MyProcPid, MyProcPid,
+						 INSTR_TIME_GET_MILLISEC(span->start) * 1000.0);
+		if (span->ended)
+			appendStringInfo(&buf, ", \"dur\": %.3f",
+							 INSTR_TIME_GET_MILLISEC(span->duration) * 1000.0);
+		appendStringInfo(&buf, ", \"args\": {%s}}", span->args.data);
+	}
+	appendStringInfo(&buf,
+					 "],\n\"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped\": %ld}}",
+					 trace_dropped);
+
+	if (reset)
+	{
+		trace_nspans = 0;
+		trace_dropped = 0;
+		if (trace_mcontext != NULL)
+			MemoryContextReset(trace_mcontext);
+	}
+
+	PG_RETURN_TEXT_P(cstring_to_text(buf.data));
+}
@@ -0,0 +1,31 @@
+/*-------------------------------------------------------------------------
+ *
+ * trace_funcs.h
+ *    Declarations for the session-level timeline of event processing.
+ *
+ *
+ * pg_schema_triggers/trace_funcs.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SCHEMA_TRIGGERS_TRACE_FUNCS_H
+#define SCHEMA_TRIGGERS_TRACE_FUNCS_H
+
+
+#include "postgres.h"
+#include "fmgr.h"
+
+
+extern bool trace_enabled;
+extern int trace_max_spans;
+
+
+int trace_span_begin(const char *name, const char *category, const char *argfmt, ...)
+	__attribute__((format(PG_PRINTF_ATTRIBUTE, 3, 4)));
+void trace_span_add_string(int span, const char *key, const char *value);
+void trace_span_end(int span);
+
+Datum dump_trace(PG_FUNCTION_ARGS);
+
+
+#endif	/* SCHEMA_TRIGGERS_TRACE_FUNCS_H */
@@ -18,17 +18,28 @@
 #include "access/xact.h"
 #include "catalog/dependency.h"
 #include "catalog/indexing.h"
+#include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
 #include "catalog/objectaddress.h"
 #include "catalog/pg_event_trigger.h"
+#include "catalog/pg_inherits_fn.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
 #include "commands/event_trigger.h"
 #include "commands/trigger.h"
+#include "lib/stringinfo.h"
 #include "parser/parse_func.h"
 #include "pgstat.h"
+#include "portability/instr_time.h"
+#include "storage/lock.h"
+#include "tcop/tcopprot.h"
 #include "tcop/utility.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/catcache.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
@@ -36,6 +47,14 @@
 #include "utils/syscache.h"
 
 
+#include "events.h"
+#include "lockwait_funcs.h"
+#include "notify_funcs.h"
+#include "probes.h"
+#include "queue_funcs.h"
+#include "record_funcs.h"
+#include "shmem_funcs.h"
+#include "trace_funcs.h"
 #include "trigger_funcs.h"
 
 
@@ -44,204 +63,1450 @@ typedef struct EventTriggerContext {
 	MemoryContext mcontext;
 	MemoryContext old_mcontext;		/* Enter/LeaveMemoryContext() use this. */
 	EventTriggerData trigdata;
+	EventCommand command;			/* the statement which raised the events */
 	EventInfo *info;
 	struct EventTriggerContext *prev;
-	dlist_head event_list_head;
+	EventQueue *queue;				/* events to fire when the statement ends */
+	NotifyQueue *notify;			/* notifications to publish at that point */
+	List *deferred;					/* DeferredCapture entries, in order */
+	List *at_end;					/* StatementEndItem entries, in order */
+	List *collapsing;				/* CollapsingEvent entries, in order */
+	Oid relation;					/* the statement's relation, and its */
+	List *descendants;				/* inheritance descendants, once found */
+	bool descendants_valid;
+	int32 num_events;				/* number of events enqueued so far */
+	int depth;						/* enclosing statements firing triggers */
+	List *stats;					/* StatementEventStats entries */
+	List *trigger_stats;			/* StatementTriggerStats entries */
+	instr_time capture_start;		/* when the next event's capture began */
+	uint64 capture_fetches;			/* catalog_fetch_count at that point */
+	TriggerTimingFunc timing;		/* when replaying, gets trigger timings */
+	void *timing_arg;
+	bool measured;					/* for ddl_statement_end, if true: */
+	instr_time start;				/* when the statement began */
+	LockWaitCounters lock_start;	/* lock waits sampled until then */
+	int64 catalog_rows_start;		/* catalog_rows_written() until then */
 } EventTriggerContext;
 
 EventTriggerContext *current_context = NULL;
 
+/* Number of EventTriggerContexts allocated and not yet freed. */
+static int live_contexts = 0;
 
+/* The DryRunEvents gathered by the dry run in progress, if any. */
+static bool dry_run = false;
+static MemoryContext dry_run_mcontext = NULL;
+static List *dry_run_events = NIL;
+
+int max_nesting_depth = 8;
+
+
+/* An event to be raised when the statement ends. */
+typedef struct StatementEndItem {
+	StatementEndFunc func;
+	Oid objectId;
+} StatementEndItem;
+
+
+/* An event whose capture of a column's catalog rows has been deferred. */
+typedef struct DeferredCapture {
+	EventInfo *info;
+	int16 attnum;
+} DeferredCapture;
+
+
+/*
+ * The statistics gathered for one event during a statement, which are added
+ * to the shared totals when the statement ends.
+ */
+typedef struct StatementEventStats {
+	char *eventname;
+	EventStatsCounters counters;
+} StatementEventStats;
+
+/* Likewise, the calls of one event trigger during a statement. */
+typedef struct StatementTriggerStats {
+	Oid trigger;
+	TriggerStatsCounters counters;
+} StatementTriggerStats;
+
+
+/*
+ * An event on the statement's relation which absorbs the same event on the
+ * relation's inheritance descendants, when its triggers ask for that.  The
+ * descendants' events may be raised before or after the relation's own.
+ */
+typedef struct CollapsingEvent {
+	const char *eventname;
+	int32 stmt_index;				/* the relation's event, or 0 if not yet raised */
+	List *children;					/* relations whose events were absorbed */
+} CollapsingEvent;
+
+
+/*
+ * Cache of the enabled event triggers for each of our events, so that neither
+ * capturing nor firing an event has to scan pg_event_trigger.  Entries are
+ * filled in on first use, and the whole cache is discarded whenever
+ * pg_event_trigger changes.
+ */
+typedef struct EventTriggerCacheItem {
+	Oid trigoid;
+	NameData trigname;
+	Oid fnoid;
+	EventTriggerOptions options;
+} EventTriggerCacheItem;
+
+typedef struct EventTriggerCacheEntry {
+	char eventname[NAMEDATALEN];	/* hash key */
+	List *triggers;					/* EventTriggerCacheItems, in name order */
+	EventCaptureLevel capture;		/* highest level any trigger asks for */
+	bool collapse_children;			/* true if every trigger asks for that */
+	bool skip_nested;				/* likewise */
+} EventTriggerCacheEntry;
+
+static MemoryContext event_trigger_cache_context = NULL;
+static HTAB *event_trigger_cache = NULL;
+static bool event_trigger_cache_valid = false;
+
+
+static ArrayType *whenclause_to_tags(List *whenclause);
+static void tags_to_options(ArrayType *tags, EventTriggerOptions *options);
+static void invalidate_event_trigger_cache(Datum arg, int cacheid, uint32 hashvalue);
+static EventTriggerCacheEntry *lookup_event_triggers(const char *eventname);
+static List *scan_event_triggers(const char *eventname, EventCaptureLevel *capture,
+								 bool *collapse_children, bool *skip_nested);
+static List *statement_descendants(void);
+static CollapsingEvent *new_collapsing_event(const char *eventname);
+static List *collapsed_children(EventInfo *info);
+static EventStatsCounters *statement_event_stats(const char *eventname);
+static TriggerStatsCounters *statement_trigger_stats(Oid trigger);
+static void record_statement_trigger_stats(void);
+static void record_statement_stats(void);
+static void dry_run_statement(void);
+static void dry_run_add_event(EventInfo *event);
+static DryRunEvent *dry_run_event(const char *eventname);
+static void push_event_context(Node *parsetree, const char *tag, const char *queryString);
+static void free_event_context(void);
+static void measure_statement(StatementCost *cost);
+static void event_xact_callback(XactEvent event, void *arg);
+static void stamp_event(EventInfo *info);
 static void fire_event(EventInfo *info);
 static void invoke_event_triggers(List *runlist);
+static void account_trigger_time(EventTriggerCacheItem *item, double elapsed);
 List * find_event_triggers_for_event(const char *eventname);
 
 
 /*
- * Create an event trigger for the given event name which will call the
- * function 'trigfunc'.  Note that this function does not check that the event
- * name is valid, nor does it check that the function has the right number
- * and type of arguments or the correct return type.
+ * Create an event trigger for the given event name which will call the
+ * function 'trigfunc', with the per-trigger options given in 'whenclause'.
+ * Note that this function does not check that the event name is valid, nor
+ * does it check that the function has the right number and type of arguments
+ * or the correct return type.
+ */
+Oid
+CreateEventTriggerEx(const char *eventname, const char *trigname, Oid trigfunc, List *whenclause)
+{
+	/* Declarations from CreateEventTrigger(). */
+    HeapTuple   tuple;
+    Oid			evtOwner = GetUserId();
+
+	/* Declarations from insert_event_trigger_tuple(). */
+    Relation    tgrel;
+    Oid         trigoid;
+    HeapTuple   tgtuple;
+    Datum       values[Natts_pg_event_trigger];
+    bool        nulls[Natts_pg_event_trigger];
+    NameData    evtnamedata,
+                evteventdata;
+    ObjectAddress myself,
+                referenced;
+	ArrayType  *tags;
+
+    /*
+     * It would be nice to allow database owners or even regular users to do
+     * this, but there are obvious privilege escalation risks which would have
+     * to somehow be plugged first.
+     */
+    if (!superuser())
+        ereport(ERROR,
+                (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+                 errmsg("permission denied to create event trigger \"%s\"",
+                        trigname),
+                 errhint("Must be superuser to create an event trigger.")));
+
+    /*
+     * Give user a nice error message if an event trigger of the same name
+     * already exists.
+     */
+    tuple = SearchSysCache1(EVENTTRIGGERNAME, CStringGetDatum(trigname));
+    if (HeapTupleIsValid(tuple))
+        ereport(ERROR,
+                (errcode(ERRCODE_DUPLICATE_OBJECT),
+                 errmsg("event trigger \"%s\" already exists",
+                        trigname)));
+
+	/* Check the options, and turn them into tags. */
+	tags = whenclause_to_tags(whenclause);
+
+    /* Open pg_event_trigger. */
+    tgrel = heap_open(EventTriggerRelationId, RowExclusiveLock);
+
+    /* Build the new pg_event_trigger tuple. */
+    memset(nulls, false, sizeof(nulls));
+    namestrcpy(&evtnamedata, trigname);
+    values[Anum_pg_event_trigger_evtname - 1] = NameGetDatum(&evtnamedata);
+    namestrcpy(&evteventdata, eventname);
+    values[Anum_pg_event_trigger_evtevent - 1] = NameGetDatum(&evteventdata);
+    values[Anum_pg_event_trigger_evtowner - 1] = ObjectIdGetDatum(evtOwner);
+    values[Anum_pg_event_trigger_evtfoid - 1] = ObjectIdGetDatum(trigfunc);
+    values[Anum_pg_event_trigger_evtenabled - 1] =
+        CharGetDatum(TRIGGER_FIRES_ON_ORIGIN);
+	if (tags != NULL)
+		values[Anum_pg_event_trigger_evttags - 1] = PointerGetDatum(tags);
+	else
+		nulls[Anum_pg_event_trigger_evttags - 1] = true;
+
+    /* Insert heap tuple. */
+    tgtuple = heap_form_tuple(tgrel->rd_att, values, nulls);
+    trigoid = simple_heap_insert(tgrel, tgtuple);
+    CatalogUpdateIndexes(tgrel, tgtuple);
+    heap_freetuple(tgtuple);
+
+    /* Depend on owner. */
+    recordDependencyOnOwner(EventTriggerRelationId, trigoid, evtOwner);
+
+    /* Depend on event trigger function. */
+    myself.classId = EventTriggerRelationId;
+    myself.objectId = trigoid;
+    myself.objectSubId = 0;
+    referenced.classId = ProcedureRelationId;
+    referenced.objectId = trigfunc;
+    referenced.objectSubId = 0;
+    recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+
+    /* Post creation hook for new operator family */
+    InvokeObjectPostCreateHook(EventTriggerRelationId, trigoid, 0);
+
+    /* Close pg_event_trigger and return. */
+    heap_close(tgrel, RowExclusiveLock);
+	return trigoid;
+}
+
+
+/*
+ * Check the per-trigger options given in a WHEN clause, and convert them to a
+ * text[] of "name=value" tags for pg_event_trigger.evttags.  Returns NULL if
+ * there are no options.
+ *
+ * pg_dump writes the tags back out as WHEN TAG IN ('capture=light', ...), so
+ * options are accepted in that form too.
+ */
+static ArrayType *
+whenclause_to_tags(List *whenclause)
+{
+	EventTriggerOptions options;
+	List *names = NIL;
+	List *values = NIL;
+	Datum *tags;
+	int ntags = 0;
+	ListCell *lc;
+	ListCell *lv;
+
+	if (whenclause == NIL)
+		return NULL;
+
+	/* Collect the options' names and values. */
+	foreach(lc, whenclause)
+	{
+		DefElem *def = (DefElem *) lfirst(lc);
+		List *args = (List *) def->arg;
+
+		if (strcmp(def->defname, "tag") == 0)
+		{
+			foreach(lv, args)
+			{
+				char *tag = pstrdup(strVal(lfirst(lv)));
+				char *sep = strchr(tag, '=');
+
+				if (sep == NULL)
+					ereport(ERROR,
+							(errcode(ERRCODE_SYNTAX_ERROR),
+							 errmsg("WHEN TAG value \"%s\" is not of the form option=value",
+									tag)));
+				*sep = '\0';
+				names = lappend(names, tag);
+				values = lappend(values, sep + 1);
+			}
+			continue;
+		}
+		if (list_length(args) != 1)
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("WHEN option \"%s\" takes exactly one value",
+							def->defname)));
+		names = lappend(names, def->defname);
+		values = lappend(values, strVal(linitial(args)));
+	}
+
+	/* Check them, and turn them into tags. */
+	InitEventTriggerOptions(&options);
+	tags = (Datum *) palloc(list_length(names) * sizeof(Datum));
+	forboth(lc, names, lv, values)
+	{
+		const char *name = (const char *) lfirst(lc);
+		const char *value = (const char *) lfirst(lv);
+		StringInfoData tag;
+		ListCell *prev;
+
+		foreach(prev, names)
+		{
+			if (prev == lc)
+				break;
+			if (strcmp((const char *) lfirst(prev), name) == 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("WHEN option \"%s\" specified more than once",
+								name)));
+		}
+		SetEventTriggerOption(&options, name, value);
+
+		initStringInfo(&tag);
+		appendStringInfo(&tag, "%s=%s", name, value);
+		tags[ntags++] = CStringGetTextDatum(tag.data);
+	}
+
+	return construct_array(tags, ntags, TEXTOID, -1, false, 'i');
+}
+
+
+/*
+ * Parse the "name=value" tags of an event trigger created by
+ * CreateEventTriggerEx().
+ */
+static void
+tags_to_options(ArrayType *tags, EventTriggerOptions *options)
+{
+	Datum *elems;
+	int nelems;
+	int i;
+
+	deconstruct_array(tags, TEXTOID, -1, false, 'i', &elems, NULL, &nelems);
+	for (i = 0; i < nelems; i++)
+	{
+		char *tag = TextDatumGetCString(elems[i]);
+		char *sep = strchr(tag, '=');
+
+		if (sep == NULL)
+			elog(ERROR, "malformed event trigger option \"%s\"", tag);
+		*sep = '\0';
+		SetEventTriggerOption(options, tag, sep + 1);
+	}
+}
+
+
+void
+InitEventTriggerOptions(EventTriggerOptions *options)
+{
+	options->capture = CAPTURE_FULL;
+	options->collapse_children = false;
+	options->skip_nested = false;
+	options->budget = 0;
+	options->overrun_error = true;
+}
+
+
+/*
+ * Set one per-trigger option, raising an error if the option or its value
+ * are not recognized.
+ */
+void
+SetEventTriggerOption(EventTriggerOptions *options, const char *name, const char *value)
+{
+	if (strcmp(name, "capture") == 0)
+	{
+		if (strcmp(value, "oid") == 0)
+			options->capture = CAPTURE_OID;
+		else if (strcmp(value, "light") == 0)
+			options->capture = CAPTURE_LIGHT;
+		else if (strcmp(value, "full") == 0)
+			options->capture = CAPTURE_FULL;
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for WHEN option \"%s\": \"%s\"",
+							name, value),
+					 errhint("Valid values are \"oid\", \"light\" and \"full\".")));
+	}
+	else if (strcmp(name, "children") == 0)
+	{
+		if (strcmp(value, "each") == 0)
+			options->collapse_children = false;
+		else if (strcmp(value, "collapse") == 0)
+			options->collapse_children = true;
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for WHEN option \"%s\": \"%s\"",
+							name, value),
+					 errhint("Valid values are \"each\" and \"collapse\".")));
+	}
+	else if (strcmp(name, "nested") == 0)
+	{
+		if (strcmp(value, "fire") == 0)
+			options->skip_nested = false;
+		else if (strcmp(value, "skip") == 0)
+			options->skip_nested = true;
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for WHEN option \"%s\": \"%s\"",
+							name, value),
+					 errhint("Valid values are \"fire\" and \"skip\".")));
+	}
+	else if (strcmp(name, "budget") == 0)
+	{
+		if (!parse_int(value, &options->budget, GUC_UNIT_MS, NULL) || options->budget < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for WHEN option \"%s\": \"%s\"",
+							name, value),
+					 errhint("Valid values are durations such as \"100ms\" or \"2s\".")));
+	}
+	else if (strcmp(name, "overrun") == 0)
+	{
+		if (strcmp(value, "error") == 0)
+			options->overrun_error = true;
+		else if (strcmp(value, "warn") == 0)
+			options->overrun_error = false;
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for WHEN option \"%s\": \"%s\"",
+							name, value),
+					 errhint("Valid values are \"error\" and \"warn\".")));
+	}
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("unrecognized WHEN option \"%s\"", name)));
+}
+
+
+/*
+ * Beginning a new statement;  allocate a new EventTriggerContext, and
+ * remember the command so that triggers can tell what is being done.
+ *
+ * A statement run by an event trigger is nested one level deeper than the
+ * statement whose event is being fired;  refuse to go deeper than
+ * schema_triggers.max_nesting_depth, so that triggers whose DDL fires more
+ * triggers can't cascade without bound.
+ */
+void
+StartNewEvent(Node *parsetree, const char *queryString)
+{
+	bool measure;
+
+	/*
+	 * Measure a DDL statement for ddl_statement_end, if any trigger wants
+	 * that.  (Other utility statements may run in an aborted transaction,
+	 * where the triggers can't be looked up.)  The triggers are looked up
+	 * before the context is pushed, as an error once it has been would leave
+	 * it behind:  the caller only pops it on errors from the statement.
+	 */
+	measure = (GetCommandLogLevel(parsetree) == LOGSTMT_DDL &&
+			   lookup_event_triggers("ddl_statement_end")->triggers != NIL);
+
+	push_event_context(parsetree, CreateCommandTag(parsetree), queryString);
+	if (measure)
+	{
+		lockwait_start();
+		current_context->measured = true;
+		lockwait_read(&current_context->lock_start);
+		current_context->catalog_rows_start = catalog_rows_written();
+		INSTR_TIME_SET_CURRENT(current_context->start);
+	}
+}
+
+
+/*
+ * Allocate a new EventTriggerContext for a statement and make it current.
+ * The parse tree is NULL for a statement whose events are being replayed.
+ */
+static void
+push_event_context(Node *parsetree, const char *tag, const char *queryString)
+{
+	EventTriggerContext *prev = current_context;
+	MemoryContext old_mcontext;
+	int depth = 0;
+	int span;
+
+	if (prev != NULL)
+		depth = prev->depth + (prev->info != NULL ? 1 : 0);
+	span = trace_span_begin("StartNewEvent", "statement", "\"depth\": %d", depth);
+	trace_span_add_string(span, "command", tag);
+	if (depth > max_nesting_depth)
+		ereport(ERROR,
+				(errcode(ERRCODE_STATEMENT_TOO_COMPLEX),
+				 errmsg("event trigger nesting depth exceeds the limit of %d",
+						max_nesting_depth),
+				 errhint("An event trigger may be running DDL which fires it again.  "
+						 "The limit is set by schema_triggers.max_nesting_depth.")));
+
+	current_context = palloc(sizeof(EventTriggerContext));
+	live_contexts++;
+	current_context->mcontext = AllocSetContextCreate(CurrentMemoryContext,
+                                     "event info context",
+                                     ALLOCSET_DEFAULT_MINSIZE,
+                                     ALLOCSET_DEFAULT_INITSIZE,
+                                     ALLOCSET_DEFAULT_MAXSIZE);
+	current_context->old_mcontext = NULL;
+    current_context->prev = prev;
+	current_context->command.parsetree = parsetree;
+	current_context->command.node_tag = parsetree != NULL ? nodeTag(parsetree) : T_Invalid;
+	current_context->command.tag = tag;
+	current_context->command.query = queryString;
+	current_context->deferred = NIL;
+	current_context->at_end = NIL;
+	current_context->collapsing = NIL;
+	current_context->relation = InvalidOid;
+	current_context->descendants = NIL;
+	current_context->descendants_valid = false;
+	current_context->num_events = 0;
+	current_context->depth = depth;
+	current_context->stats = NIL;
+	current_context->trigger_stats = NIL;
+	INSTR_TIME_SET_ZERO(current_context->capture_start);
+	current_context->capture_fetches = 0;
+	current_context->timing = NULL;
+	current_context->timing_arg = NULL;
+	current_context->measured = false;
+
+	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+	current_context->queue = event_queue_create();
+	current_context->notify = notify_queue_create();
+	MemoryContextSwitchTo(old_mcontext);
+	trace_span_end(span);
+}
+
+
+void
+EnterEventMemoryContext()
+{
+	Assert(current_context->old_mcontext == NULL);
+	
+	current_context->old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+}
+
+
+void
+LeaveEventMemoryContext()
+{
+	MemoryContext prev;
+	
+	Assert(current_context->old_mcontext != NULL);
+	prev = MemoryContextSwitchTo(current_context->old_mcontext);
+	Assert(prev == current_context->mcontext);
+	current_context->old_mcontext = NULL;
+}
+
+
+/* The memory context events are set up in, for rows captured into them. */
+MemoryContext
+EventMemoryContext()
+{
+	return current_context->mcontext;
+}
+
+
+void
+EndEvent()
+{
+	EventInfo *event;
+	StatementCost cost;
+	ListCell *lc;
+	int record;
+	int span;
+
+	Assert(current_context != NULL);
+	span = trace_span_begin("EndEvent", "statement", "\"depth\": %d",
+							current_context->depth);
+	trace_span_add_string(span, "command", current_context->command.tag);
+	if (current_context->measured)
+		measure_statement(&cost);
+
+	/* Raise the events which describe the statement's final results. */
+	foreach(lc, current_context->at_end)
+	{
+		StatementEndItem *item = (StatementEndItem *) lfirst(lc);
+
+		BeginEventCapture();
+		item->func(item->objectId);
+	}
+
+	/* Then the one describing the statement itself, last of all. */
+	if (current_context->measured)
+	{
+		cost.events = current_context->num_events;
+		BeginEventCapture();
+		ddl_statement_end_event(&cost);
+	}
+
+	/* Complete any deferred captures before the events are fired. */
+	ResolveEventCaptures(InvalidOid, 0);
+
+	/* A dry run only sums up the events which would be fired. */
+	if (dry_run)
+	{
+		dry_run_statement();
+		free_event_context();
+		trace_span_end(span);
+		return;
+	}
+
+	/*
+	 * Fire any enqueued events, reading back those spilled to disk, and
+	 * record them if schema_triggers.record_file is set.
+	 */
+	record = record_open();
+	event_queue_rewind(current_context->queue);
+	while ((event = event_queue_next(current_context->queue)) != NULL)
+	{
+		event->children = collapsed_children(event);
+		if (record >= 0)
+			record_event(record, &current_context->command, event);
+		fire_event(event);
+	}
+	record_close(record);
+
+	/* Publish the events to any configured NOTIFY channels. */
+	publish_events(current_context->notify);
+	record_statement_stats();
+
+	free_event_context();
+	trace_span_end(span);
+}
+
+
+/*
+ * The statement is being aborted by an error;  discard its context without
+ * firing any of its events.  The queued events, deferred captures, statement
+ * end items and collapsed children all live in the context, and go with it.
+ */
+void
+AbortEvent()
+{
+	Assert(current_context != NULL);
+
+	/* The error may have been raised inside EnterEventMemoryContext(). */
+	if (current_context->old_mcontext != NULL)
+		LeaveEventMemoryContext();
+	current_context->info = NULL;
+	free_event_context();
+}
+
+
+/*
+ * Free the current EventTriggerContext, returning to the enclosing
+ * statement's.
+ */
+static void
+free_event_context(void)
+{
+	EventTriggerContext *prev = current_context->prev;
+
+	if (current_context->measured)
+		lockwait_stop();
+	event_queue_free(current_context->queue);
+	MemoryContextDelete(current_context->mcontext);
+	pfree(current_context);
+	current_context = prev;
+	live_contexts--;
+}
+
+
+/*
+ * What the statement has taken so far:  the time since it began, the lock
+ * waits sampled and the catalog rows written since then.
+ */
+static void
+measure_statement(StatementCost *cost)
+{
+	LockWaitCounters lock_end;
+	instr_time duration;
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, current_context->start);
+	cost->elapsed = INSTR_TIME_GET_MILLISEC(duration);
+
+	lockwait_read(&lock_end);
+	cost->lock_wait = (double) (lock_end.wait_time - current_context->lock_start.wait_time);
+	if (lock_end.samples > current_context->lock_start.samples)
+	{
+		cost->lock_relation = lock_end.relation;
+		cost->lock_mode = lock_end.mode;
+	}
+	else
+	{
+		cost->lock_relation = InvalidOid;
+		cost->lock_mode = NoLock;
+	}
+	cost->events = current_context->num_events;
+	cost->catalog_rows = catalog_rows_written() - current_context->catalog_rows_start;
+}
+
+
+/*
+ * Start a dry run.  Until EndDryRun(), each statement's events are captured
+ * and queued as usual, but when the statement ends they are summed up in
+ * DryRunEvents, allocated in 'mcontext', instead of being fired.  Nor are
+ * they published, recorded, or added to the statistics.
+ */
+void
+BeginDryRun(MemoryContext mcontext)
+{
+	if (dry_run)
+		elog(ERROR, "a dry run is already in progress");
+	dry_run = true;
+	dry_run_mcontext = mcontext;
+	dry_run_events = NIL;
+}
+
+
+/*
+ * End the dry run, returning its DryRunEvents in the order the events were
+ * first raised.
+ */
+List *
+EndDryRun(void)
+{
+	List *events = dry_run_events;
+
+	dry_run = false;
+	dry_run_mcontext = NULL;
+	dry_run_events = NIL;
+	return events;
+}
+
+
+/*
+ * Add the statement's queued events to the dry run:  the memory they take in
+ * the queue, and the triggers they would fire.
+ * The number captured, and the work done capturing them, come from the
+ * statement's statistics.
+ */
+static void
+dry_run_statement(void)
+{
+	EventInfo *event;
+	ListCell *lc;
+
+	event_queue_rewind(current_context->queue);
+	while ((event = event_queue_next(current_context->queue)) != NULL)
+	{
+		dry_run_event(event->eventname)->queue_bytes += event_size(event);
+		dry_run_add_event(event);
+	}
+
+	foreach(lc, current_context->stats)
+	{
+		StatementEventStats *stats = (StatementEventStats *) lfirst(lc);
+		DryRunEvent *entry = dry_run_event(stats->eventname);
+
+		entry->events += stats->counters.captured;
+		entry->catalog_fetches += stats->counters.catalog_fetches;
+		entry->capture_time += stats->counters.capture_time;
+	}
+}
+
+
+/* Add the triggers find_event_triggers_for_event() picks for an event to the dry run. */
+static void
+dry_run_add_event(EventInfo *event)
+{
+	DryRunEvent *entry = dry_run_event(event->eventname);
+	List *runlist = find_event_triggers_for_event(event->eventname);
+	MemoryContext old_mcontext;
+	ListCell *lc;
+
+	entry->trigger_calls += list_length(runlist);
+	old_mcontext = MemoryContextSwitchTo(dry_run_mcontext);
+	foreach(lc, runlist)
+	{
+		EventTriggerCacheItem *item = (EventTriggerCacheItem *) lfirst(lc);
+		char *trigname = NameStr(item->trigname);
+		ListCell *lc2;
+		bool found = false;
+
+		foreach(lc2, entry->triggers)
+		{
+			if (strcmp((char *) lfirst(lc2), trigname) == 0)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			entry->triggers = lappend(entry->triggers, pstrdup(trigname));
+	}
+	MemoryContextSwitchTo(old_mcontext);
+	list_free_deep(runlist);
+}
+
+
+/* Return the dry run's entry for an event, adding it if need be. */
+static DryRunEvent *
+dry_run_event(const char *eventname)
+{
+	MemoryContext old_mcontext;
+	DryRunEvent *entry;
+	ListCell *lc;
+
+	foreach(lc, dry_run_events)
+	{
+		entry = (DryRunEvent *) lfirst(lc);
+		if (strcmp(entry->eventname, eventname) == 0)
+			return entry;
+	}
+
+	old_mcontext = MemoryContextSwitchTo(dry_run_mcontext);
+	entry = (DryRunEvent *) palloc0(sizeof(DryRunEvent));
+	entry->eventname = pstrdup(eventname);
+	dry_run_events = lappend(dry_run_events, entry);
+	MemoryContextSwitchTo(old_mcontext);
+	return entry;
+}
+
+
+/*
+ * Fire the triggers of a recorded event, as if the statement given by 'tag'
+ * and 'query' had just raised it.  Each trigger's execution time is passed to
+ * 'timing' instead of being added to its statistics, and is not held to the
+ * trigger's budget;  the event's statistics are not kept either.
+ */
+void
+ReplayEvent(EventInfo *info, const char *tag, const char *query,
+			TriggerTimingFunc timing, void *arg)
+{
+	push_event_context(NULL, tag, query);
+	current_context->timing = timing;
+	current_context->timing_arg = arg;
+
+	PG_TRY();
+	{
+		fire_event(info);
+	}
+	PG_CATCH();
+	{
+		AbortEvent();
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	free_event_context();
+}
+
+
+/*
+ * Number of statements whose EventTriggerContexts are still allocated:  the
+ * statements being run, including those run by the event triggers being
+ * fired.  Outside any utility statement this is zero, unless a context has
+ * been leaked.
+ */
+int
+GetEventContextCount()
+{
+	return live_contexts;
+}
+
+
+void
+InitEventTriggers()
+{
+	RegisterXactCallback(event_xact_callback, NULL);
+}
+
+
+void
+FiniEventTriggers()
+{
+	UnregisterXactCallback(event_xact_callback, NULL);
+}
+
+
+/*
+ * Every statement's context is freed by EndEvent() or AbortEvent(), so none
+ * should be left when a transaction aborts.  If any are, their memory has
+ * gone with the aborted transaction's;  forget them, but complain.
+ */
+static void
+event_xact_callback(XactEvent event, void *arg)
+{
+	if (event != XACT_EVENT_ABORT || live_contexts == 0)
+		return;
+
+	elog(WARNING, "schema_triggers leaked %d event trigger context(s)", live_contexts);
+	current_context = NULL;
+	live_contexts = 0;
+	lockwait_reset();
+}
+
+
+/*
+ * Note that an event's capture is beginning, so that the time taken and the
+ * catalog scans made until the event is enqueued are counted against it.
+ */
+void
+BeginEventCapture()
+{
+	if (current_context == NULL)
+		return;
+
+	INSTR_TIME_SET_CURRENT(current_context->capture_start);
+	current_context->capture_fetches = catalog_fetch_count;
+}
+
+
+/*
+ * Forget the capture begun by BeginEventCapture(), for an event which won't
+ * be raised after all, so that its time isn't counted against the next one.
+ */
+void
+CancelEventCapture()
+{
+	if (current_context == NULL)
+		return;
+
+	INSTR_TIME_SET_ZERO(current_context->capture_start);
+}
+
+
+/*
+ * Find the statistics gathered for an event by the current statement, adding
+ * an entry if there are none yet.
+ */
+static EventStatsCounters *
+statement_event_stats(const char *eventname)
+{
+	MemoryContext old_mcontext;
+	StatementEventStats *stats;
+	ListCell *lc;
+
+	foreach(lc, current_context->stats)
+	{
+		stats = (StatementEventStats *) lfirst(lc);
+		if (strcmp(stats->eventname, eventname) == 0)
+			return &stats->counters;
+	}
+
+	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+	stats = (StatementEventStats *) palloc0(sizeof(StatementEventStats));
+	stats->eventname = pstrdup(eventname);
+	current_context->stats = lappend(current_context->stats, stats);
+	MemoryContextSwitchTo(old_mcontext);
+	return &stats->counters;
+}
+
+
+/*
+ * Find the calls of an event trigger made by the current statement, adding an
+ * entry if there are none yet.
+ */
+static TriggerStatsCounters *
+statement_trigger_stats(Oid trigger)
+{
+	MemoryContext old_mcontext;
+	StatementTriggerStats *stats;
+	ListCell *lc;
+
+	foreach(lc, current_context->trigger_stats)
+	{
+		stats = (StatementTriggerStats *) lfirst(lc);
+		if (stats->trigger == trigger)
+			return &stats->counters;
+	}
+
+	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+	stats = (StatementTriggerStats *) palloc0(sizeof(StatementTriggerStats));
+	stats->trigger = trigger;
+	current_context->trigger_stats = lappend(current_context->trigger_stats, stats);
+	MemoryContextSwitchTo(old_mcontext);
+	return &stats->counters;
+}
+
+
+/*
+ * Add the trigger calls made by the current statement to the shared totals,
+ * and forget them.
+ */
+static void
+record_statement_trigger_stats(void)
+{
+	ListCell *lc;
+
+	foreach(lc, current_context->trigger_stats)
+	{
+		StatementTriggerStats *stats = (StatementTriggerStats *) lfirst(lc);
+
+		record_trigger_stats(stats->trigger, &stats->counters);
+	}
+	current_context->trigger_stats = NIL;
+}
+
+
+/*
+ * Add the statistics gathered by the current statement to the shared totals,
+ * taking the shared lock once per event or trigger rather than once per
+ * occurrence.
+ */
+static void
+record_statement_stats(void)
+{
+	ListCell *lc;
+
+	foreach(lc, current_context->stats)
+	{
+		StatementEventStats *stats = (StatementEventStats *) lfirst(lc);
+
+		stats->counters.max_queued = stats->counters.captured;
+		record_event_stats(stats->eventname, &stats->counters);
+	}
+	record_statement_trigger_stats();
+}
+
+
+/*
+ * Allocate space for the EventInfo struct described by 'desc'.
+ */
+EventInfo *
+EventInfoAlloc(const EventInfoDesc *desc)
+{
+	MemoryContext old_mcontext;
+	EventInfo *info;
+
+	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);	
+	info = (EventInfo *)palloc0(desc->struct_size);
+	strncpy(info->eventname, desc->eventname, sizeof(info->eventname) - 1);
+	info->eventname[sizeof(info->eventname) - 1] = '\0';
+	info->desc = desc;
+	MemoryContextSwitchTo(old_mcontext);
+
+	return info;
+}
+
+
+/*
+ * Defer the capture of the catalog rows for a column of an event's relation,
+ * so that the rows of many events can be fetched together by the event's
+ * resolve function.  This must be called before EnqueueEvent().  The capture
+ * is completed before the event is fired or spilled to disk, or earlier by
+ * ResolveEventCaptures() or TakeDeferredCapture().
+ */
+void
+DeferEventCapture(EventInfo *info, int16 attnum)
+{
+	MemoryContext old_mcontext;
+	DeferredCapture *deferred;
+
+	if (current_context == NULL)
+		elog(ERROR, "schema trigger event occurred outside any utility command");
+	Assert(info->desc->resolve != NULL);
+
+	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+	deferred = (DeferredCapture *) palloc(sizeof(DeferredCapture));
+	deferred->info = info;
+	deferred->attnum = attnum;
+	current_context->deferred = lappend(current_context->deferred, deferred);
+	MemoryContextSwitchTo(old_mcontext);
+}
+
+
+/*
+ * Remove and return the event whose capture for the given column is still
+ * deferred, if any.  The caller becomes responsible for completing it.
+ */
+EventInfo *
+TakeDeferredCapture(Oid relation, int16 attnum)
+{
+	ListCell *lc;
+	ListCell *prev = NULL;
+
+	if (current_context == NULL)
+		return NULL;
+
+	foreach(lc, current_context->deferred)
+	{
+		DeferredCapture *deferred = (DeferredCapture *) lfirst(lc);
+
+		if (deferred->info->relation == relation && deferred->attnum == attnum)
+		{
+			EventInfo *info = deferred->info;
+
+			current_context->deferred = list_delete_cell(current_context->deferred, lc, prev);
+			pfree(deferred);
+			return info;
+		}
+		prev = lc;
+	}
+	return NULL;
+}
+
+
+/*
+ * Complete the deferred captures, if any of them are for the given column of
+ * the given relation.  An attnum of 0 matches any column of the relation, and
+ * an invalid relation Oid matches everything.  Each kind of event is resolved
+ * in a single batch.
  */
-Oid
-CreateEventTriggerEx(const char *eventname, const char *trigname, Oid trigfunc)
+void
+ResolveEventCaptures(Oid relation, int16 attnum)
 {
-	/* Declarations from CreateEventTrigger(). */
-    HeapTuple   tuple;
-    Oid			evtOwner = GetUserId();
+	List *deferred;
+	DeferredCapture **items;
+	EventInfo **events;
+	ListCell *lc;
+	int n;
+	int i;
+	int j;
 
-	/* Declarations from insert_event_trigger_tuple(). */
-    Relation    tgrel;
-    Oid         trigoid;
-    HeapTuple   tgtuple;
-    Datum       values[Natts_pg_event_trigger];
-    bool        nulls[Natts_pg_event_trigger];
-    NameData    evtnamedata,
-                evteventdata;
-    ObjectAddress myself,
-                referenced;
+	if (current_context == NULL || current_context->deferred == NIL)
+		return;
 
-    /*
-     * It would be nice to allow database owners or even regular users to do
-     * this, but there are obvious privilege escalation risks which would have
-     * to somehow be plugged first.
-     */
-    if (!superuser())
-        ereport(ERROR,
-                (errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
-                 errmsg("permission denied to create event trigger \"%s\"",
-                        trigname),
-                 errhint("Must be superuser to create an event trigger.")));
+	if (OidIsValid(relation))
+	{
+		bool found = false;
+
+		foreach(lc, current_context->deferred)
+		{
+			DeferredCapture *item = (DeferredCapture *) lfirst(lc);
+
+			if (item->info->relation == relation && (attnum == 0 || item->attnum == attnum))
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return;
+	}
 
-    /*
-     * Give user a nice error message if an event trigger of the same name
-     * already exists.
-     */
-    tuple = SearchSysCache1(EVENTTRIGGERNAME, CStringGetDatum(trigname));
-    if (HeapTupleIsValid(tuple))
-        ereport(ERROR,
-                (errcode(ERRCODE_DUPLICATE_OBJECT),
-                 errmsg("event trigger \"%s\" already exists",
-                        trigname)));
+	deferred = current_context->deferred;
+	current_context->deferred = NIL;
 
-    /* Open pg_event_trigger. */
-    tgrel = heap_open(EventTriggerRelationId, RowExclusiveLock);
+	n = list_length(deferred);
+	items = (DeferredCapture **) palloc(n * sizeof(DeferredCapture *));
+	events = (EventInfo **) palloc(n * sizeof(EventInfo *));
+	i = 0;
+	foreach(lc, deferred)
+		items[i++] = (DeferredCapture *) lfirst(lc);
 
-    /* Build the new pg_event_trigger tuple. */
-    memset(nulls, false, sizeof(nulls));
-    namestrcpy(&evtnamedata, trigname);
-    values[Anum_pg_event_trigger_evtname - 1] = NameGetDatum(&evtnamedata);
-    namestrcpy(&evteventdata, eventname);
-    values[Anum_pg_event_trigger_evtevent - 1] = NameGetDatum(&evteventdata);
-    values[Anum_pg_event_trigger_evtowner - 1] = ObjectIdGetDatum(evtOwner);
-    values[Anum_pg_event_trigger_evtfoid - 1] = ObjectIdGetDatum(trigfunc);
-    values[Anum_pg_event_trigger_evtenabled - 1] =
-        CharGetDatum(TRIGGER_FIRES_ON_ORIGIN);
-	nulls[Anum_pg_event_trigger_evttags - 1] = true;
+	for (i = 0; i < n; i++)
+	{
+		const EventInfoDesc *desc;
+		EventStatsCounters *counters;
+		instr_time start;
+		instr_time duration;
+		uint64 fetches;
+		int nevents = 0;
+
+		if (items[i] == NULL)
+			continue;
+		desc = items[i]->info->desc;
+		for (j = i; j < n; j++)
+		{
+			if (items[j] == NULL || items[j]->info->desc != desc)
+				continue;
+			events[nevents++] = items[j]->info;
+			items[j] = NULL;
+		}
+
+		/* Count the batch against the events' capture, but not its maximum. */
+		INSTR_TIME_SET_CURRENT(start);
+		fetches = catalog_fetch_count;
+		desc->resolve(events, nevents);
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		counters = statement_event_stats(desc->eventname);
+		counters->capture_time += INSTR_TIME_GET_MILLISEC(duration);
+		counters->catalog_fetches += catalog_fetch_count - fetches;
+	}
 
-    /* Insert heap tuple. */
-    tgtuple = heap_form_tuple(tgrel->rd_att, values, nulls);
-    trigoid = simple_heap_insert(tgrel, tgtuple);
-    CatalogUpdateIndexes(tgrel, tgtuple);
-    heap_freetuple(tgtuple);
+	pfree(items);
+	pfree(events);
+	list_free_deep(deferred);
+}
 
-    /* Depend on owner. */
-    recordDependencyOnOwner(EventTriggerRelationId, trigoid, evtOwner);
 
-    /* Depend on event trigger function. */
-    myself.classId = EventTriggerRelationId;
-    myself.objectId = trigoid;
-    myself.objectSubId = 0;
-    referenced.classId = ProcedureRelationId;
-    referenced.objectId = trigfunc;
-    referenced.objectSubId = 0;
-    recordDependencyOn(&myself, &referenced, DEPENDENCY_NORMAL);
+/*
+ * Enqueue an event, to be fired when the statement ends;  see stamp_event().
+ *
+ * The 'info' pointer may be retrieved by calling GetCurrentEvent(), but
+ * only during execution of an event trigger.
+ */
+void
+EnqueueEvent(EventInfo *info)
+{
+	stamp_event(info);
 
-    /* Post creation hook for new operator family */
-    InvokeObjectPostCreateHook(EventTriggerRelationId, trigoid, 0);
+	/*
+	 * If this is the statement's relation and the event's triggers want the
+	 * events of its inheritance descendants collapsed into it, claim the
+	 * first entry still waiting for the relation's own event.
+	 */
+	if (info->desc->collapse_children &&
+		lookup_event_triggers(info->eventname)->collapse_children &&
+		statement_descendants() != NIL &&
+		info->relation == current_context->relation)
+	{
+		CollapsingEvent *parent = NULL;
+		ListCell *lc;
+
+		foreach(lc, current_context->collapsing)
+		{
+			CollapsingEvent *item = (CollapsingEvent *) lfirst(lc);
+
+			if (item->stmt_index == 0 && strcmp(item->eventname, info->eventname) == 0)
+			{
+				parent = item;
+				break;
+			}
+		}
+		if (parent == NULL)
+			parent = new_collapsing_event(info->desc->eventname);
+		parent->stmt_index = info->stmt_index;
+	}
 
-    /* Close pg_event_trigger and return. */
-    heap_close(tgrel, RowExclusiveLock);
-	return trigoid;
+	TRACE_SCHEMA_TRIGGERS_EVENT_ENQUEUE(info->eventname, info->relation,
+										info->seqno, info->stmt_index);
+
+	/* The queue may spill the event to disk, so note its NOTIFY first. */
+	notify_queue_add(current_context->notify, info);
+	event_queue_append(current_context->queue, info);
 }
 
 
 /*
- * Beginning a new statement;  allocate a new EventTriggerContext.
+ * Fire an event's triggers at once, rather than when the statement ends, for
+ * events whose triggers must be able to stop the statement (by raising an
+ * error) before it goes on.  The event is published and recorded with the
+ * statement's other events, but is not collapsed;  in a dry run its triggers
+ * are only counted.
  */
 void
-StartNewEvent()
+FireEvent(EventInfo *info)
 {
-	EventTriggerContext *prev = current_context;
+	int record;
 
-	current_context = palloc(sizeof(EventTriggerContext));
-	current_context->mcontext = AllocSetContextCreate(CurrentMemoryContext,
-                                     "event info context",
-                                     ALLOCSET_DEFAULT_MINSIZE,
-                                     ALLOCSET_DEFAULT_INITSIZE,
-                                     ALLOCSET_DEFAULT_MAXSIZE);
-	current_context->old_mcontext = NULL;
-    current_context->prev = prev;
-	dlist_init(&current_context->event_list_head);
+	stamp_event(info);
+	notify_queue_add(current_context->notify, info);
+
+	if (dry_run)
+	{
+		dry_run_add_event(info);
+		return;
+	}
+
+	record = record_open();
+	if (record >= 0)
+		record_event(record, &current_context->command, info);
+	record_close(record);
+	fire_event(info);
 }
 
 
-void
-EnterEventMemoryContext()
+/*
+ * Stamp an event with its sequence number, transaction id, and position
+ * within the statement, counting it and the work done capturing it.
+ */
+static void
+stamp_event(EventInfo *info)
 {
-	Assert(current_context->old_mcontext == NULL);
-	
-	current_context->old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+	EventStatsCounters *counters;
+
+	if (current_context == NULL)
+		elog(ERROR, "schema trigger event occurred outside any utility command");
+
+	/* Count the event, and the work done capturing it. */
+	counters = statement_event_stats(info->eventname);
+	counters->captured++;
+	if (!INSTR_TIME_IS_ZERO(current_context->capture_start))
+	{
+		instr_time duration;
+		double elapsed;
+
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, current_context->capture_start);
+		elapsed = INSTR_TIME_GET_MILLISEC(duration);
+		counters->capture_time += elapsed;
+		counters->max_capture_time = Max(counters->max_capture_time, elapsed);
+		counters->catalog_fetches += catalog_fetch_count - current_context->capture_fetches;
+		INSTR_TIME_SET_ZERO(current_context->capture_start);
+	}
+
+	info->seqno = next_event_seqno();
+	info->xid = GetTopTransactionId();
+	info->stmt_index = ++current_context->num_events;
 }
 
 
-void
-LeaveEventMemoryContext()
+/*
+ * Collapse an event on an inheritance descendant of the statement's relation
+ * into the same event on the relation itself, if the event's triggers ask for
+ * that.  Returns true, cancelling the event's capture, if the descendant's
+ * event was absorbed, in which case the caller should not raise it.
+ *
+ * Each of the relation's events absorbs the matching event on every
+ * descendant:  a descendant's event goes to the first entry which doesn't
+ * have that descendant yet, whether or not the relation's own event has been
+ * raised.  (ALTER TABLE adds a column to the parent before its children, but
+ * drops it from the children first.)
+ */
+bool
+CollapseChildEvent(const char *eventname, Oid relation)
 {
-	MemoryContext prev;
-	
-	Assert(current_context->old_mcontext != NULL);
-	prev = MemoryContextSwitchTo(current_context->old_mcontext);
-	Assert(prev == current_context->mcontext);
-	current_context->old_mcontext = NULL;
+	CollapsingEvent *parent = NULL;
+	MemoryContext old_mcontext;
+	ListCell *lc;
+
+	if (current_context == NULL ||
+		!lookup_event_triggers(eventname)->collapse_children ||
+		!list_member_oid(statement_descendants(), relation))
+		return false;
+
+	foreach(lc, current_context->collapsing)
+	{
+		CollapsingEvent *item = (CollapsingEvent *) lfirst(lc);
+
+		if (strcmp(item->eventname, eventname) == 0 &&
+			!list_member_oid(item->children, relation))
+		{
+			parent = item;
+			break;
+		}
+	}
+	if (parent == NULL)
+		parent = new_collapsing_event(eventname);
+
+	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+	parent->children = lappend_oid(parent->children, relation);
+	MemoryContextSwitchTo(old_mcontext);
+
+	/* The descendant is still published with the statement's events. */
+	notify_queue_add_relation(current_context->notify, parent->eventname, relation);
+	CancelEventCapture();
+	return true;
 }
 
 
-void
-EndEvent()
+/*
+ * Return the inheritance descendants of the relation the statement alters,
+ * found with find_all_inheritors() the first time they are wanted.  Only
+ * ALTER TABLE and column renames recurse to a relation's children.
+ */
+static List *
+statement_descendants(void)
 {
-	EventTriggerContext *prev;
-	dlist_iter iter;
+	Node *parsetree = current_context->command.parsetree;
+	RangeVar *rv = NULL;
 
-	Assert(current_context != NULL);
+	if (current_context->descendants_valid || parsetree == NULL)
+		return current_context->descendants;
+
+	if (IsA(parsetree, AlterTableStmt))
+		rv = ((AlterTableStmt *) parsetree)->relation;
+	else if (IsA(parsetree, RenameStmt) &&
+			 ((RenameStmt *) parsetree)->renameType == OBJECT_COLUMN)
+		rv = ((RenameStmt *) parsetree)->relation;
+	if (rv != NULL)
+		current_context->relation = RangeVarGetRelid(rv, NoLock, true);
 
-	/* Fire any enqueued events. */
-	dlist_foreach(iter, &(current_context->event_list_head))
+	if (OidIsValid(current_context->relation) && has_subclass(current_context->relation))
 	{
-		EventInfo *event = dlist_container(EventInfo, event_list_node, iter.cur);
+		MemoryContext old_mcontext;
 
-		fire_event(event);
+		old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+		current_context->descendants =
+			list_delete_first(find_all_inheritors(current_context->relation, NoLock, NULL));
+		MemoryContextSwitchTo(old_mcontext);
 	}
+	current_context->descendants_valid = true;
+	return current_context->descendants;
+}
 
-	/* Clean up. */
-	MemoryContextDelete(current_context->mcontext);
-	prev = current_context->prev;
-	pfree(current_context);
-	current_context = prev;
+
+static CollapsingEvent *
+new_collapsing_event(const char *eventname)
+{
+	MemoryContext old_mcontext;
+	CollapsingEvent *item;
+
+	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+	item = (CollapsingEvent *) palloc(sizeof(CollapsingEvent));
+	item->eventname = eventname;
+	item->stmt_index = 0;
+	item->children = NIL;
+	current_context->collapsing = lappend(current_context->collapsing, item);
+	MemoryContextSwitchTo(old_mcontext);
+	return item;
 }
 
 
 /*
- * Allocate space for an EventInfo struct.
+ * Return true if an event should be skipped altogether, without capturing
+ * anything:  the statement was run by an event trigger, every enabled trigger
+ * on the event asks not to fire for such statements, and no NOTIFY channel
+ * wants the event either.  The event's capture is then cancelled.
  */
-EventInfo *
-EventInfoAlloc(const char *eventname, size_t struct_size)
+bool
+SuppressNestedEvent(const char *eventname)
 {
-	MemoryContext old_mcontext;
-	EventInfo *info;
+	if (current_context == NULL || current_context->depth == 0 || record_enabled())
+		return false;
+	if (!lookup_event_triggers(eventname)->skip_nested ||
+		notify_queue_wants(current_context->notify, eventname))
+		return false;
+
+	CancelEventCapture();
+	return true;
+}
 
-	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);	
-	info = (EventInfo *)palloc0(struct_size);
-	strncpy(info->eventname, eventname, sizeof(info->eventname) - 1);
-	info->eventname[sizeof(info->eventname) - 1] = '\0';
-	MemoryContextSwitchTo(old_mcontext);
 
-	return info;
+/* Return the relations whose events were collapsed into the given event. */
+static List *
+collapsed_children(EventInfo *info)
+{
+	ListCell *lc;
+
+	foreach(lc, current_context->collapsing)
+	{
+		CollapsingEvent *parent = (CollapsingEvent *) lfirst(lc);
+
+		if (parent->stmt_index == info->stmt_index)
+			return parent->children;
+	}
+	return NIL;
 }
 
 
 /*
- * Enqueue an event.
- *
- * The 'info' pointer may be retrieved by calling GetCurrentEvent(), but
- * only during execution of an event trigger.
+ * Arrange for func(objectId) to be called when the current statement ends,
+ * before any of its events are fired, so that it can raise an event which
+ * describes the final state of an object.
  */
 void
-EnqueueEvent(EventInfo *info)
+RaiseAtStatementEnd(StatementEndFunc func, Oid objectId)
 {
+	MemoryContext old_mcontext;
+	StatementEndItem *item;
+
 	if (current_context == NULL)
 		elog(ERROR, "schema trigger event occurred outside any utility command");
-	dlist_push_tail(&current_context->event_list_head, &info->event_list_node);
+
+	old_mcontext = MemoryContextSwitchTo(current_context->mcontext);
+	item = (StatementEndItem *) palloc(sizeof(StatementEndItem));
+	item->func = func;
+	item->objectId = objectId;
+	current_context->at_end = lappend(current_context->at_end, item);
+	MemoryContextSwitchTo(old_mcontext);
 }
 
 
@@ -257,6 +1522,11 @@ void
 fire_event(EventInfo *info)
 {
 	List *runlist;
+	EventStatsCounters *counters;
+	instr_time start;
+	instr_time duration;
+	double elapsed;
+	int span;
 
 	/* Event triggers are completely disabled in standalone mode. */
 	if (!IsUnderPostmaster)
@@ -267,35 +1537,57 @@ fire_event(EventInfo *info)
 
 	/* Do we have any event triggers to fire? */
 	Assert(info->eventname != NULL);
+	span = trace_span_begin("fire_event", "dispatch",
+							"\"relation\": %u, \"stmt_index\": %d",
+							info->relation, info->stmt_index);
+	trace_span_add_string(span, "event", info->eventname);
+	counters = statement_event_stats(info->eventname);
 	runlist = find_event_triggers_for_event(info->eventname);
 	if (runlist == NIL)
+	{
+		counters->skipped++;
+		trace_span_end(span);
 		return;
+	}
 
 	/* Set up the event trigger context. */
 	current_context->trigdata.type = T_EventTriggerData;
 	current_context->trigdata.event = info->eventname;
-	current_context->trigdata.tag = "";				/* Can't be NULL. */
-	current_context->trigdata.parsetree = NULL;
+	current_context->trigdata.tag = current_context->command.tag;
+	current_context->trigdata.parsetree = current_context->command.parsetree;
 	current_context->info = info;
 
 	/*
 	 * Fire the event triggers inside a PG_TRY() block to ensure that we
 	 * clean up current_event_info, even in the event of an exception.
 	 */
+	TRACE_SCHEMA_TRIGGERS_EVENT_FIRE_START(info->eventname, info->relation,
+										   list_length(runlist));
+	INSTR_TIME_SET_CURRENT(start);
 	PG_TRY();
 	{
 		invoke_event_triggers(runlist);
 	}
 	PG_CATCH();
 	{
-		current_context = NULL;
+		/* The statement's context is freed by AbortEvent(). */
+		current_context->info = NULL;
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
 
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	elapsed = INSTR_TIME_GET_MILLISEC(duration);
+	counters->fired++;
+	counters->dispatch_time += elapsed;
+	counters->max_dispatch_time = Max(counters->max_dispatch_time, elapsed);
+	TRACE_SCHEMA_TRIGGERS_EVENT_FIRE_DONE(info->eventname, info->relation);
+
 	/* Cleanup. */
-	list_free(runlist);
+	list_free_deep(runlist);
 	current_context->info = NULL;
+	trace_span_end(span);
 }
 
 
@@ -328,20 +1620,38 @@ invoke_event_triggers(List *runlist)
 	/* Fire each event trigger that matched. */
 	foreach(lc, runlist)
 	{
-		Oid         fnoid = lfirst_oid(lc);
+		EventTriggerCacheItem *item = (EventTriggerCacheItem *) lfirst(lc);
 		FmgrInfo    flinfo;
 		FunctionCallInfoData fcinfo;
 		PgStat_FunctionCallUsage fcusage;
+		instr_time	start;
+		instr_time	duration;
+		int			span;
 
 		/* Look up the function. */
-		fmgr_info(fnoid, &flinfo);
+		fmgr_info(item->fnoid, &flinfo);
 
 		InitFunctionCallInfoData(fcinfo, &flinfo, 0,
 								InvalidOid, (Node *)trigdata, NULL);
 
+		TRACE_SCHEMA_TRIGGERS_TRIGGER_START(current_context->info->eventname,
+											current_context->info->relation,
+											item->trigoid);
+		span = trace_span_begin("trigger", "dispatch",
+								"\"trigger\": %u, \"function\": %u",
+								item->trigoid, item->fnoid);
+		trace_span_add_string(span, "event", current_context->info->eventname);
+		INSTR_TIME_SET_CURRENT(start);
 		pgstat_init_function_usage(&fcinfo, &fcusage);
 		FunctionCallInvoke(&fcinfo);
 		pgstat_end_function_usage(&fcusage, true);
+		INSTR_TIME_SET_CURRENT(duration);
+		trace_span_end(span);
+		TRACE_SCHEMA_TRIGGERS_TRIGGER_DONE(current_context->info->eventname,
+										   current_context->info->relation,
+										   item->trigoid);
+		INSTR_TIME_SUBTRACT(duration, start);
+		account_trigger_time(item, INSTR_TIME_GET_MILLISEC(duration));
 
 		/*
 		 * Make sure anything the event triggers did will be visible to the
@@ -359,6 +1669,48 @@ invoke_event_triggers(List *runlist)
 }
 
 
+/*
+ * Add a trigger's execution time (in milliseconds) to the statement's
+ * statistics, and complain if it ran past its budget:  an error rolls the
+ * statement back, so that a slow trigger can't hold the statement's locks for
+ * long.  The statement's trigger calls are added to the shared totals before
+ * that error, since it discards them.  Replayed events hand the time to the
+ * replay instead.
+ */
+static void
+account_trigger_time(EventTriggerCacheItem *item, double elapsed)
+{
+	bool overrun = (item->options.budget > 0 && elapsed > item->options.budget);
+	TriggerStatsCounters *counters;
+
+	if (current_context->timing != NULL)
+	{
+		current_context->timing(item->trigoid, NameStr(item->trigname),
+								current_context->info->eventname, elapsed,
+								current_context->timing_arg);
+		return;
+	}
+
+	counters = statement_trigger_stats(item->trigoid);
+	counters->calls++;
+	if (overrun)
+		counters->overruns++;
+	counters->total_time += elapsed;
+	counters->max_time = Max(counters->max_time, elapsed);
+	if (!overrun)
+		return;
+
+	if (item->options.overrun_error)
+		record_statement_trigger_stats();
+
+	ereport(item->options.overrun_error ? ERROR : WARNING,
+			(errcode(ERRCODE_QUERY_CANCELED),
+			 errmsg("event trigger \"%s\" exceeded its time budget of %d ms",
+					NameStr(item->trigname), item->options.budget),
+			 errdetail("The trigger ran for %.3f ms.", elapsed)));
+}
+
+
 /*
  * Retrieve the EventInfo that was passed to FireEventTriggers().  Only valid
  * during execution of an event trigger.
@@ -386,22 +1738,132 @@ GetCurrentEvent(const char *eventname)
 	return current_context->info;
 }
 
- 
+
+/*
+ * Return the command whose events are being fired.
+ */
+const EventCommand *
+GetCurrentCommand(void)
+{
+	if (current_context == NULL || current_context->info == NULL)
+		elog(ERROR, "may only be called from an event trigger.");
+
+	return &current_context->command;
+}
+
+
+
+/*
+ * Fill in the metadata columns (seqno, xid, stmt_index) which trail every
+ * *_eventinfo record.  The sequence number is NULL if the library was not
+ * loaded through shared_preload_libraries.
+ */
+void
+EventInfoGetMetaDatums(EventInfo *info, Datum *values, bool *isnull)
+{
+	values[0] = Int64GetDatum((int64) info->seqno);
+	isnull[0] = (info->seqno == 0);
+	values[1] = TransactionIdGetDatum(info->xid);
+	isnull[1] = false;
+	values[2] = Int32GetDatum(info->stmt_index);
+	isnull[2] = false;
+}
+
+
+/*
+ * Throw away the event trigger cache when pg_event_trigger changes.  This can
+ * happen in the middle of filling in an entry, so only mark the cache invalid
+ * here;  lookup_event_triggers() discards it on its next call.
+ */
+static void
+invalidate_event_trigger_cache(Datum arg, int cacheid, uint32 hashvalue)
+{
+	event_trigger_cache_valid = false;
+}
+
+
+/*
+ * Look up the cache entry for an event, filling it in if necessary.  The
+ * entry is only valid until the next call.
+ */
+static EventTriggerCacheEntry *
+lookup_event_triggers(const char *eventname)
+{
+	char key[NAMEDATALEN];
+	EventTriggerCacheEntry *entry;
+	List *triggers;
+	EventCaptureLevel capture;
+	bool collapse_children;
+	bool skip_nested;
+
+	/* (Re)create the cache if necessary. */
+	if (!event_trigger_cache_valid)
+	{
+		HASHCTL ctl;
+
+		if (event_trigger_cache_context == NULL)
+		{
+			if (CacheMemoryContext == NULL)
+				CreateCacheMemoryContext();
+			event_trigger_cache_context = AllocSetContextCreate(CacheMemoryContext,
+										 "schema_triggers event trigger cache",
+										 ALLOCSET_DEFAULT_MINSIZE,
+										 ALLOCSET_DEFAULT_INITSIZE,
+										 ALLOCSET_DEFAULT_MAXSIZE);
+			CacheRegisterSyscacheCallback(EVENTTRIGGEROID,
+										  invalidate_event_trigger_cache,
+										  (Datum) 0);
+		}
+		else
+			MemoryContextResetAndDeleteChildren(event_trigger_cache_context);
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = NAMEDATALEN;
+		ctl.entrysize = sizeof(EventTriggerCacheEntry);
+		ctl.hcxt = event_trigger_cache_context;
+		event_trigger_cache = hash_create("schema_triggers event trigger cache",
+										  16, &ctl, HASH_ELEM | HASH_CONTEXT);
+		event_trigger_cache_valid = true;
+	}
+
+	memset(key, 0, sizeof(key));
+	strlcpy(key, eventname, sizeof(key));
+	entry = (EventTriggerCacheEntry *) hash_search(event_trigger_cache, key, HASH_FIND, NULL);
+	if (entry != NULL)
+		return entry;
+
+	/* Not cached yet, so scan pg_event_trigger. */
+	triggers = scan_event_triggers(eventname, &capture, &collapse_children, &skip_nested);
+	entry = (EventTriggerCacheEntry *) hash_search(event_trigger_cache, key, HASH_ENTER, NULL);
+	entry->triggers = triggers;
+	entry->capture = capture;
+	entry->collapse_children = collapse_children;
+	entry->skip_nested = skip_nested;
+	return entry;
+}
+
+
 /*
  * Scan (yes, seqscan) through pg_event_triggers to find any enabled event
- * triggers for the given event name, and return a List of function Oids to
- * execute.
- *
- * TODO:  build a cache, so we don't have to seqscan each time.
+ * triggers for the given event name, and return a List of
+ * EventTriggerCacheItems allocated in the cache's memory context.  The
+ * highest capture level asked for by any of the triggers (or CAPTURE_OID, if
+ * there are none) is returned in 'capture';  'collapse_children' and
+ * 'skip_nested' are set if there are triggers and all of them ask for that.
  */
-List *
-find_event_triggers_for_event(const char *eventname)
+static List *
+scan_event_triggers(const char *eventname, EventCaptureLevel *capture,
+					bool *collapse_children, bool *skip_nested)
 {
-	List       *funclist = NIL;
+	List       *triggers = NIL;
 	Relation    rel;
 	Relation    irel;
 	SysScanDesc	scan;
 
+	*capture = CAPTURE_OID;
+	*collapse_children = true;
+	*skip_nested = true;
+
 	/*
 	 * Open pg_event_trigger and do a full scan, ordered by the event trigger's
 	 * name.
@@ -416,6 +1878,10 @@ find_event_triggers_for_event(const char *eventname)
 		HeapTuple   tup;
 		Form_pg_event_trigger form;
 		char       *evtevent;
+		EventTriggerCacheItem *item;
+		Datum		tags;
+		bool		isnull;
+		MemoryContext old_mcontext;
 
 		/* Get next tuple. */
 		tup = systable_getnext_ordered(scan, ForwardScanDirection);
@@ -427,13 +1893,36 @@ find_event_triggers_for_event(const char *eventname)
         if (form->evtenabled == TRIGGER_DISABLED)
             continue;
 
-        /* Check event name.  XXX:  we ignore evttags[] entirely. */
+        /* Check event name. */
         evtevent = NameStr(form->evtevent);
         if (strcmp(evtevent, eventname) != 0)
         	continue;
 
-        /* Event trigger matches.  Add evtfoid to our list. */
-		funclist = lappend_oid(funclist, form->evtfoid);
+        /* Event trigger matches.  Remember its function and options. */
+		old_mcontext = MemoryContextSwitchTo(event_trigger_cache_context);
+		item = (EventTriggerCacheItem *) palloc(sizeof(EventTriggerCacheItem));
+		item->trigoid = HeapTupleGetOid(tup);
+		item->trigname = form->evtname;
+		item->fnoid = form->evtfoid;
+		InitEventTriggerOptions(&item->options);
+		tags = heap_getattr(tup, Anum_pg_event_trigger_evttags,
+							RelationGetDescr(rel), &isnull);
+		if (!isnull)
+			tags_to_options(DatumGetArrayTypeP(tags), &item->options);
+		triggers = lappend(triggers, item);
+		MemoryContextSwitchTo(old_mcontext);
+
+		if (item->options.capture > *capture)
+			*capture = item->options.capture;
+		if (!item->options.collapse_children)
+			*collapse_children = false;
+		if (!item->options.skip_nested)
+			*skip_nested = false;
+	}
+	if (triggers == NIL)
+	{
+		*collapse_children = false;
+		*skip_nested = false;
 	}
 
 	/* Done with the scan. */
@@ -441,6 +1930,48 @@ find_event_triggers_for_event(const char *eventname)
 	index_close(irel, AccessShareLock);
 	relation_close(rel, AccessShareLock);
 
-	/* Return the list of functions to invoke. */
-	return funclist; 
+	return triggers;
+}
+
+
+/*
+ * Return a List of copies of the EventTriggerCacheItems of the enabled event
+ * triggers for the given event name, in the order they should be executed.
+ * (The cache may be rebuilt while the triggers run.)  Triggers which don't
+ * fire for statements run by event triggers are left out of those.
+ */
+List *
+find_event_triggers_for_event(const char *eventname)
+{
+	EventTriggerCacheEntry *entry;
+	List *runlist = NIL;
+	ListCell *lc;
+
+	entry = lookup_event_triggers(eventname);
+	foreach(lc, entry->triggers)
+	{
+		EventTriggerCacheItem *item = (EventTriggerCacheItem *) lfirst(lc);
+		EventTriggerCacheItem *copy;
+
+		if (item->options.skip_nested && current_context->depth > 0)
+			continue;
+		copy = (EventTriggerCacheItem *) palloc(sizeof(EventTriggerCacheItem));
+		memcpy(copy, item, sizeof(EventTriggerCacheItem));
+		runlist = lappend(runlist, copy);
+	}
+	return runlist;
+}
+
+
+/*
+ * Return how much of the catalog rows the given event should capture:  the
+ * highest level any of its enabled event triggers asks for, or all of them
+ * if events are being recorded.
+ */
+EventCaptureLevel
+GetEventCaptureLevel(const char *eventname)
+{
+	if (record_enabled())
+		return CAPTURE_FULL;
+	return lookup_event_triggers(eventname)->capture;
 }
@@ -14,22 +14,170 @@
 
 #include "postgres.h"
 #include "lib/ilist.h"
+#include "nodes/pg_list.h"
+
+
+#include "catalog_funcs.h"
+
+
+/* The types of the fields of an event's EventInfo struct. */
+typedef enum EventFieldType {
+	EVENT_FIELD_OID,
+	EVENT_FIELD_INT16,
+	EVENT_FIELD_INT32,
+	EVENT_FIELD_INT64,
+	EVENT_FIELD_FLOAT4,
+	EVENT_FIELD_FLOAT8,
+	EVENT_FIELD_BOOL,
+	EVENT_FIELD_ROW,			/* a CapturedRow from a system catalog */
+	EVENT_FIELD_ROW_ARRAY		/* a CapturedRowArray */
+} EventFieldType;
+
+
+/*
+ * Describes one field of an event's EventInfo struct, so that the struct can
+ * be handled without knowing its C type.
+ */
+typedef struct EventFieldDesc {
+	const char *name;			/* as in the event's *_eventinfo record */
+	EventFieldType type;
+	size_t offset;				/* offset within the EventInfo struct */
+} EventFieldDesc;
+
+
+struct EventInfo;
+
+/*
+ * Completes the catalog rows of a batch of events whose capture was deferred
+ * with DeferEventCapture().
+ */
+typedef void (*EventResolveFunc) (struct EventInfo **events, int nevents);
+
+
+/*
+ * Describes an event's EventInfo struct.  The common header fields (including
+ * the relation) are not listed in 'fields'.
+ */
+typedef struct EventInfoDesc {
+	const char *eventname;
+	size_t struct_size;
+	int nfields;
+	const EventFieldDesc *fields;
+	EventResolveFunc resolve;	/* for deferred captures, or NULL */
+	bool collapse_children;		/* may absorb its inheritance children's events */
+} EventInfoDesc;
 
 
 typedef struct EventInfo {
 	char eventname[NAMEDATALEN];
+	const EventInfoDesc *desc;
+	Oid relation;				/* the relation the event applies to */
+	uint64 seqno;				/* cluster-wide sequence number, or 0 */
+	TransactionId xid;			/* top-level transaction id */
+	int32 stmt_index;			/* 1-based position within the statement */
+	List *children;				/* relations whose events were collapsed into
+								 * this one;  set when the event is fired */
+	struct varlena *jsonb;		/* get_current_event_jsonb() result, once built */
 	dlist_node event_list_node;
 } EventInfo;
 
 
-void StartNewEvent(void);
+/*
+ * The utility command whose events are being fired.  On the PostgreSQL
+ * versions supported, the query string is the whole source text the command
+ * came from, which may hold other commands too.
+ */
+typedef struct EventCommand {
+	Node *parsetree;
+	NodeTag node_tag;
+	const char *tag;			/* as from CreateCommandTag() */
+	const char *query;
+} EventCommand;
+
+
+/* Receives each trigger's execution time, in ms, while events are replayed. */
+typedef void (*TriggerTimingFunc) (Oid trigoid, const char *trigname,
+								   const char *eventname, double elapsed, void *arg);
+
+
+/* Raises an event for an object when the statement ends;  see RaiseAtStatementEnd(). */
+typedef void (*StatementEndFunc) (Oid objectId);
+
+
+/*
+ * Per-trigger options, given in the WHEN clause of CREATE EVENT TRIGGER and
+ * stored as "name=value" strings in pg_event_trigger.evttags.
+ */
+typedef struct EventTriggerOptions {
+	EventCaptureLevel capture;	/* WHEN capture IN ('oid' | 'light' | 'full') */
+	bool collapse_children;		/* WHEN children IN ('each' | 'collapse') */
+	bool skip_nested;			/* WHEN nested IN ('fire' | 'skip') */
+	int budget;					/* WHEN budget IN ('<duration>'), in ms, or 0 */
+	bool overrun_error;			/* WHEN overrun IN ('error' | 'warn') */
+} EventTriggerOptions;
+
+
+/* The events a dry run found, and what firing them would take;  see BeginDryRun(). */
+typedef struct DryRunEvent {
+	char *eventname;
+	int64 events;				/* number captured */
+	List *triggers;				/* names of the triggers they would fire */
+	int64 trigger_calls;
+	int64 catalog_fetches;
+	double capture_time;		/* in ms */
+	int64 queue_bytes;			/* memory used in the statement's queue */
+} DryRunEvent;
+
+
+/* What a DDL statement took, for the ddl_statement_end event. */
+typedef struct StatementCost {
+	double elapsed;				/* in ms, until the statement's work was done */
+	double lock_wait;			/* in ms spent waiting for locks, as sampled */
+	Oid lock_relation;			/* relation last waited for, or InvalidOid */
+	int32 lock_mode;			/* lock mode last waited for, or NoLock */
+	int32 events;				/* events raised before ddl_statement_end */
+	int64 catalog_rows;			/* system catalog rows written */
+} StatementCost;
+
+
+extern int max_nesting_depth;
+
+
+/* Number of metadata columns which trail every *_eventinfo record. */
+#define EVENTINFO_META_NATTS 3
+
+
+void StartNewEvent(Node *parsetree, const char *queryString);
 void EnterEventMemoryContext(void);
 void LeaveEventMemoryContext(void);
+MemoryContext EventMemoryContext(void);
 void EndEvent(void);
-EventInfo *EventInfoAlloc(const char *eventname, size_t struct_size);
-Oid CreateEventTriggerEx(const char *eventname, const char *trigname, Oid trigfunc);
+void AbortEvent(void);
+void BeginDryRun(MemoryContext mcontext);
+List *EndDryRun(void);
+void ReplayEvent(EventInfo *info, const char *tag, const char *query,
+				 TriggerTimingFunc timing, void *arg);
+int GetEventContextCount(void);
+void InitEventTriggers(void);
+void FiniEventTriggers(void);
+void BeginEventCapture(void);
+void CancelEventCapture(void);
+EventInfo *EventInfoAlloc(const EventInfoDesc *desc);
+Oid CreateEventTriggerEx(const char *eventname, const char *trigname, Oid trigfunc, List *whenclause);
+void InitEventTriggerOptions(EventTriggerOptions *options);
+void SetEventTriggerOption(EventTriggerOptions *options, const char *name, const char *value);
+EventCaptureLevel GetEventCaptureLevel(const char *eventname);
+void DeferEventCapture(EventInfo *info, int16 attnum);
+EventInfo *TakeDeferredCapture(Oid relation, int16 attnum);
+void ResolveEventCaptures(Oid relation, int16 attnum);
 void EnqueueEvent(EventInfo *info);
+void FireEvent(EventInfo *info);
+bool CollapseChildEvent(const char *eventname, Oid relation);
+bool SuppressNestedEvent(const char *eventname);
+void RaiseAtStatementEnd(StatementEndFunc func, Oid objectId);
 EventInfo* GetCurrentEvent(const char *eventname);
+const EventCommand *GetCurrentCommand(void);
+void EventInfoGetMetaDatums(EventInfo *info, Datum *values, bool *isnull);
 
 
 #endif	/* SCHEMA_TRIGGERS_TRIGGER_FUNCS_H */